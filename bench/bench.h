@@ -0,0 +1,60 @@
+#pragma once
+// bits shared by the benchmarks in bench/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "util/except.h"
+
+namespace ace { namespace bench {
+    struct Stats {
+        double min, median, mean, stddev, max;
+    };
+
+    inline Stats get_stats(std::vector<double> times) {
+        std::sort(times.begin(), times.end());
+        Stats s{ times.front(), times[times.size() / 2], 0, 0, times.back() };
+        for (const double t : times) s.mean += t;
+        s.mean /= times.size();
+        for (const double t : times) s.stddev += (t - s.mean) * (t - s.mean);
+        s.stddev = std::sqrt(s.stddev / times.size());
+        return s;
+    }
+
+    inline std::vector<uint8_t> read_file(const std::string &path) {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f) THROW_ERROR("COULDN'T OPEN FILE {}", path);
+
+        fseek(f, 0, SEEK_END);
+        std::vector<uint8_t> buf(ftell(f));
+        rewind(f);
+        const size_t read = fread(buf.data(), 1, buf.size(), f);
+        fclose(f);
+        if (read != buf.size()) THROW_ERROR("COULDN'T READ FILE {}", path);
+        return buf;
+    }
+
+    // ms since start
+    inline double elapsed_ms(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // one warmup run that isn't counted, then ms for each of the others
+    template<typename F>
+    std::vector<double> time_runs(int runs, F &&func) {
+        func();
+        std::vector<double> times;
+        for (int i = 0; i < runs; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            times.push_back(elapsed_ms(start));
+        }
+        return times;
+    }
+
+    // the compiler can't throw away work whose result ends up here
+    static volatile uint64_t sink;
+}}
@@ -0,0 +1,113 @@
+// times the GL-free map core over real .vxl files, nothing here needs a window.
+// usage: map_bench [-r runs] [-n samples] map.vxl [more.vxl ...]
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "vxl.h"
+#include "bench.h"
+
+using namespace ace;
+using namespace ace::bench;
+
+namespace {
+    void report(const char *name, const std::vector<double> &times, size_t items) {
+        const Stats s = get_stats(times);
+        fmt::print("  {:<11} min {:9.3f} ms  median {:9.3f} ms  mean {:9.3f} ms  stddev {:7.3f} ms  {:10.1f} ns/item ({} items)\n",
+                   name, s.min, s.median, s.mean, s.stddev, s.median * 1e6 / items, items);
+    }
+}
+
+int main(int argc, char **argv) {
+    int runs = 10, samples = 100000;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            runs = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            samples = std::max(1, atoi(argv[++i]));
+        } else {
+            files.emplace_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        fmt::print("usage: {} [-r runs] [-n samples] map.vxl [more.vxl ...]\n", argv[0]);
+        return 1;
+    }
+
+    for (const auto &path : files) {
+        auto buf = read_file(path);
+        AceMap map(buf.data());
+        fmt::print("{} ({} bytes, {} runs, {} samples)\n", path, buf.size(), runs, samples);
+
+        report("read", time_runs(runs, [&] { map.read(buf.data()); }), MAP_X * MAP_Y);
+        report("write", time_runs(runs, [&] { sink = map.write().size(); }), MAP_X * MAP_Y);
+
+        // fixed seed, so every run and every build measures exactly the same points
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<int> column(0, MAP_X - 1);
+        std::uniform_real_distribution<float> unit(0, 1);
+
+        std::vector<glm::ivec3> surface;
+        while (surface.size() < size_t(samples)) {
+            const int x = column(rng), y = column(rng), z = map.get_z(x, y);
+            if (z < int(MAP_Z) - 2) surface.emplace_back(x, y, z);
+        }
+
+        std::vector<std::pair<glm::vec3, glm::vec3>> rays;
+        for (const auto &p : surface) {
+            const float yaw = unit(rng) * 6.2831853f, pitch = (unit(rng) - 0.5f) * 0.5f;
+            const glm::vec3 dir(std::cos(yaw) * std::cos(pitch), std::sin(yaw) * std::cos(pitch), std::sin(pitch));
+            rays.emplace_back(glm::vec3(p) + glm::vec3(0.5f, 0.5f, -2.5f), dir);
+        }
+
+        std::vector<std::pair<glm::ivec3, glm::ivec3>> lines;
+        for (const auto &p : surface) {
+            const glm::ivec3 offset(column(rng) % 65 - 32, column(rng) % 65 - 32, column(rng) % 17 - 8);
+            lines.emplace_back(p, glm::clamp(p + offset, glm::ivec3(0), glm::ivec3(MAP_X - 1, MAP_Y - 1, MAP_Z - 1)));
+        }
+
+        report("get_color", time_runs(runs, [&] {
+            uint64_t sum = 0;
+            for (const auto &p : surface) sum += map.get_color(p.x, p.y, p.z);
+            sink = sum;
+        }), surface.size());
+
+        report("hitscan", time_runs(runs, [&] {
+            uint64_t sum = 0;
+            // a miss leaves hit alone
+            glm::ivec3 hit(0);
+            for (const auto &r : rays) sum += int(map.hitscan(r.first, r.second, &hit)) + hit.x;
+            sink = sum;
+        }), rays.size());
+
+        report("block_line", time_runs(runs, [&] {
+            uint64_t sum = 0;
+            for (const auto &l : lines) map.block_line(l.first, l.second, [&sum](const glm::ivec3 &b) { sum += b.z; });
+            sink = sum;
+        }), lines.size());
+
+        // only the search, nothing gets destroyed so every run sees the same map
+        std::vector<VXLBlock> destroyed;
+        report("check_node", time_runs(runs, [&] {
+            uint64_t sum = 0;
+            for (const auto &p : surface) sum += map.check_node(p.x, p.y, p.z, false, destroyed);
+            sink = sum;
+        }), surface.size());
+
+        report("get_vis", time_runs(runs, [&] {
+            uint64_t sum = 0;
+            for (int y = 0; y < int(MAP_Y); y++) {
+                for (int x = 0; x < int(MAP_X); x++) {
+                    for (int z = 0; z < int(MAP_Z); z++) sum += map.get_vis(x, y, z);
+                }
+            }
+            sink = sum;
+        }), MAP_X * MAP_Y * MAP_Z);
+    }
+    return 0;
+}
@@ -0,0 +1,350 @@
+// times turning a map into vertices the way DrawMap's mesh workers do it, plus loose blocks and kv6 models.
+// the CPU side needs no window, -gl (only built with the game) also times uploading and drawing the meshes.
+// usage: mesh_bench [-r runs] [-gl] [-k model.kv6 ...] map.vxl [more.vxl ...]
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "vxl.h"
+#include "kv6_data.h"
+#include "draw/mesher.h"
+#include "bench.h"
+
+#ifdef ACE_MESH_BENCH_GL
+#include <SDL.h>
+#include "glad/glad.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "gl/gl_util.h"
+#include "gl/shader.h"
+#endif
+
+using namespace ace;
+using namespace ace::bench;
+using namespace ace::draw;
+using namespace ace::draw::detail;
+
+namespace {
+    constexpr size_t PILLARS = (MAP_X / PILLAR_SIZE) * (MAP_Y / PILLAR_SIZE);
+
+    void report(const char *name, const std::vector<double> &times) {
+        const Stats s = get_stats(times);
+        fmt::print("  {:<14} min {:9.3f} ms  median {:9.3f} ms  mean {:9.3f} ms  stddev {:7.3f} ms\n", name, s.min, s.median, s.mean, s.stddev);
+    }
+
+    // times of every pillar in every run, in us
+    void report_pillar_times(const char *name, const std::vector<double> &times) {
+        const Stats s = get_stats(times);
+        fmt::print("  {:<14} min {:9.2f} us  median {:9.2f} us  mean {:9.2f} us  max {:9.2f} us per pillar\n", name, s.min, s.median, s.mean, s.max);
+    }
+
+    void report_vertices(const char *name, size_t vertices, size_t vertex_size, size_t items) {
+        fmt::print("  {:<14} {} vertices, {:.2f} MB, {:.1f} vertices per item ({} items)\n",
+                   name, vertices, vertices * vertex_size / (1024.0 * 1024.0), double(vertices) / items, items);
+    }
+
+    struct PillarResult {
+        std::vector<double> copy_times, mesh_times;
+        size_t vertices{ 0 }, lod_vertices{ 0 };
+        // of the last run, for -gl
+        std::vector<std::unique_ptr<PillarMesh>> meshes;
+    };
+
+    // every pillar in the same order DrawMap::gen_pillars makes them, per_voxel is what edited pillars get
+    PillarResult mesh_map(AceMap &map, const std::vector<uint8_t> &light, int runs, bool per_voxel) {
+        PillarResult result;
+        auto snapshot = std::make_unique<PillarSnapshot>();
+        // warmup run first, same as time_runs
+        for (int run = 0; run <= runs; run++) {
+            result.vertices = result.lod_vertices = 0;
+            result.meshes.clear();
+            for (size_t i = 0; i < PILLARS; i++) {
+                auto start = std::chrono::steady_clock::now();
+                snapshot->index = i;
+                snapshot->per_voxel = per_voxel;
+                snapshot->lods = true;
+                snapshot->copy(map, light, int(i / (MAP_Y / PILLAR_SIZE) * PILLAR_SIZE), int(i % (MAP_Y / PILLAR_SIZE) * PILLAR_SIZE));
+                const double copy = elapsed_ms(start);
+
+                start = std::chrono::steady_clock::now();
+                auto mesh = std::make_unique<PillarMesh>();
+                mesh_pillar(*snapshot, *mesh);
+                const double build = elapsed_ms(start);
+
+                if (run != 0) {
+                    result.copy_times.push_back(copy * 1000);
+                    result.mesh_times.push_back(build * 1000);
+                }
+                result.vertices += mesh->vertices.size();
+                for (const auto &lod : mesh->lods) result.lod_vertices += lod.size();
+                result.meshes.push_back(std::move(mesh));
+            }
+        }
+        return result;
+    }
+
+    void report_pillars(const char *name, const PillarResult &r) {
+        std::vector<double> totals;
+        for (size_t i = 0; i < r.mesh_times.size(); i += PILLARS) {
+            double total = 0;
+            for (size_t j = i; j < i + PILLARS; j++) total += r.mesh_times[j];
+            totals.push_back(total / 1000);
+        }
+        report(name, totals);
+        report_pillar_times("", r.mesh_times);
+        report_vertices("", r.vertices, sizeof(VXLVertex), PILLARS);
+        report_vertices("  lods", r.lod_vertices, sizeof(VXLVertex), PILLARS);
+    }
+
+#ifdef ACE_MESH_BENCH_GL
+    // same layout as scene::SceneUniforms, map.vert needs it
+#pragma pack(push, 1)
+    struct SceneUniforms {
+        glm::mat4 view, proj, pv;
+        glm::vec3 cam_forward; float ___pad1;
+        glm::vec3 cam_right; float ___pad2;
+        glm::vec3 cam_up; float ___pad3;
+        glm::vec3 fog_color; float ___pad4;
+        glm::vec3 light_pos;
+        float fog_start, fog_end; float ___pad5[3];
+    };
+#pragma pack(pop)
+    static_assert(offsetof(SceneUniforms, fog_start) == 268, "fog_start has to line up with the std140 layout in map.vert");
+
+    struct GLContext {
+        GLContext() {
+            if (SDL_Init(SDL_INIT_VIDEO) < 0) THROW_ERROR("SDL_Init: {}", SDL_GetError());
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+            SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+            this->window = SDL_CreateWindow("mesh_bench", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+            if (this->window == nullptr) THROW_ERROR("SDL_CreateWindow: {}", SDL_GetError());
+            this->context = SDL_GL_CreateContext(this->window);
+            if (this->context == nullptr) THROW_ERROR("SDL_GL_CreateContext: {}", SDL_GetError());
+            if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) THROW_ERROR("gladLoaderGLLoader fail");
+            SDL_GL_SetSwapInterval(0);
+            fmt::print("GL: {} ({})\n", reinterpret_cast<const char *>(glGetString(GL_VERSION)), reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+        }
+
+        ~GLContext() {
+            SDL_GL_DeleteContext(this->context);
+            SDL_DestroyWindow(this->window);
+            SDL_Quit();
+        }
+
+        ACE_NO_COPY_MOVE(GLContext)
+
+        SDL_Window *window;
+        SDL_GLContext context;
+    };
+
+    // ms the GPU spent on whatever func submits, glFinish'd so the CPU time is the whole thing too
+    template<typename F>
+    double gpu_time(F &&func) {
+        gl::query q;
+        glBeginQuery(GL_TIME_ELAPSED, q);
+        func();
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 ns;
+        glGetQueryObjectui64v(q, GL_QUERY_RESULT, &ns);
+        return ns / 1e6;
+    }
+
+    // the pillars go into one shared buffer at the same offsets DrawMap would give them (before any edits),
+    // then the whole map is drawn from above with map.vert/map.frag and one draw per pillar
+    void gl_bench(int runs, const std::vector<std::unique_ptr<PillarMesh>> &meshes) {
+        std::vector<size_t> offsets;
+        size_t quads = 0, max_quads = 0;
+        for (const auto &mesh : meshes) {
+            offsets.push_back(quads);
+            quads += mesh->vertices.size() / 4;
+            max_quads = std::max(max_quads, mesh->vertices.size() / 4);
+        }
+
+        gl::experimental::vbo<VXLVertex> vertices{ GL_DYNAMIC_DRAW };
+        vertices.reserve(quads * 4);
+        gl::experimental::ebo<GLuint> indices;
+        gl::experimental::vao vao;
+        vao.attrib_pointer("1I,4Bn", vertices.handle).element_buffer(indices.handle);
+        for (GLuint i = 0; i < max_quads * 4; i += 4) {
+            indices->insert(indices->end(), { i, i + 1, i + 2, i + 2, i + 1, i + 3 });
+        }
+        indices.upload();
+
+        std::vector<double> upload_cpu, upload_gpu;
+        for (int run = 0; run <= runs; run++) {
+            const auto start = std::chrono::steady_clock::now();
+            const double gpu = gpu_time([&] {
+                for (size_t i = 0; i < meshes.size(); i++) {
+                    if (!meshes[i]->vertices.empty()) vertices.update(offsets[i] * 4, meshes[i]->vertices.data(), meshes[i]->vertices.size());
+                }
+                glFinish();
+            });
+            if (run == 0) continue;
+            upload_cpu.push_back(elapsed_ms(start));
+            upload_gpu.push_back(gpu);
+        }
+        report("upload cpu", upload_cpu);
+        report("upload gpu", upload_gpu);
+
+        gl::ShaderProgram shader({
+            { "shaders/map.vert", GL_VERTEX_SHADER },
+            { "shaders/map.frag", GL_FRAGMENT_SHADER }
+        });
+        shader.bind();
+        shader.uniform("model", glm::mat4(1.0f));
+
+        // looking down at the middle of the map from one corner, fog far enough away to not matter
+        gl::experimental::ubo<SceneUniforms> uniforms;
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, uniforms.handle);
+        glUniformBlockBinding(shader.program, glGetUniformBlockIndex(shader.program, "SceneUniforms"), 0);
+        const glm::vec3 eye(0, -160, 0), center(MAP_X / 2, 0, MAP_Y / 2);
+        uniforms->view = glm::lookAt(eye, center, glm::vec3(0, 1, 0));
+        uniforms->proj = glm::perspective(glm::radians(75.0f), 1280.0f / 720.0f, 0.1f, 1024.0f);
+        uniforms->pv = uniforms->proj * uniforms->view;
+        uniforms->fog_color = glm::vec3(0.5f);
+        uniforms->light_pos = glm::normalize(glm::vec3{ -0.16, 0.8, 0.56 });
+        uniforms->fog_start = 1024;
+        uniforms->fog_end = 2048;
+        uniforms.upload();
+
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glViewport(0, 0, 1280, 720);
+
+        std::vector<double> draw_cpu, draw_gpu;
+        for (int run = 0; run <= runs; run++) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            const auto start = std::chrono::steady_clock::now();
+            const double gpu = gpu_time([&] {
+                vao.bind();
+                for (size_t i = 0; i < meshes.size(); i++) {
+                    const GLsizei count = GLsizei(meshes[i]->vertices.size() / 4 * 6);
+                    if (count == 0) continue;
+                    // the pillar origin is an instanced attribute in DrawMap, a constant one does the same here
+                    glVertexAttrib3f(2, float(i / (MAP_Y / PILLAR_SIZE) * PILLAR_SIZE), 0, float(i % (MAP_Y / PILLAR_SIZE) * PILLAR_SIZE));
+                    glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr, GLint(offsets[i] * 4));
+                }
+                glFinish();
+            });
+            if (run == 0) continue;
+            draw_cpu.push_back(elapsed_ms(start));
+            draw_gpu.push_back(gpu);
+        }
+        report("draw cpu", draw_cpu);
+        report("draw gpu", draw_gpu);
+        fmt::print("  {} draws, {} quads\n", meshes.size(), quads);
+    }
+#endif
+}
+
+int main(int argc, char **argv) {
+    int runs = 10;
+    bool use_gl = false;
+    std::vector<std::string> maps, models;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            runs = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+            models.emplace_back(argv[++i]);
+        } else if (!strcmp(argv[i], "-gl")) {
+            use_gl = true;
+        } else {
+            maps.emplace_back(argv[i]);
+        }
+    }
+    if (maps.empty() && models.empty()) {
+        fmt::print("usage: {} [-r runs] [-gl] [-k model.kv6 ...] map.vxl [more.vxl ...]\n", argv[0]);
+        return 1;
+    }
+
+#ifdef ACE_MESH_BENCH_GL
+    std::unique_ptr<GLContext> context;
+    if (use_gl) context = std::make_unique<GLContext>();
+#else
+    if (use_gl) {
+        fmt::print("built without GL (ACE_HEADLESS), ignoring -gl\n");
+        use_gl = false;
+    }
+#endif
+
+    for (const auto &path : maps) {
+        auto buf = read_file(path);
+        AceMap map(buf.data());
+        fmt::print("{} ({} pillars, {} runs)\n", path, PILLARS, runs);
+
+        std::vector<uint8_t> light;
+        report("light", time_runs(runs, [&] { gen_light(map, light); }));
+
+        const PillarResult greedy = mesh_map(map, light, runs, false);
+        report_pillar_times("snapshot", greedy.copy_times);
+        report_pillars("greedy", greedy);
+        report_pillars("per voxel", mesh_map(map, light, runs, true));
+
+        // ghost block lines (faces from the blocks themselves) and falling debris (faces from the map),
+        // between random surface points with a fixed seed
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<int> column(0, MAP_X - 1);
+        std::vector<std::vector<VXLBlock>> lines, debris;
+        while (lines.size() < 1000) {
+            const int x = column(rng), y = column(rng), z = map.get_z(x, y);
+            if (z >= int(MAP_Z) - 3) continue;
+            const glm::ivec3 start(x, y, z - 1), end(glm::min(glm::ivec3(MAP_X - 1, MAP_Y - 1, MAP_Z - 3), start + glm::ivec3(column(rng) % 12, column(rng) % 12, 0)));
+            std::vector<VXLBlock> line, fall;
+            map.block_line(start, end, [&line](const glm::ivec3 &b) { line.push_back({ b, 0x7F808080 }); });
+            for (int dz = 0; dz < 8 && z + dz < int(MAP_Z); dz++) {
+                const glm::ivec3 p(x, y, z + dz);
+                if (!map.get_solid(p.x, p.y, p.z)) continue;
+                fall.push_back({ p, map.get_color(p.x, p.y, p.z), map.get_vis(p.x, p.y, p.z) });
+            }
+            lines.push_back(std::move(line));
+            debris.push_back(std::move(fall));
+        }
+
+        std::vector<glm::ivec3> lookup;
+        std::vector<VXLVertex> vertices;
+        size_t line_vertices = 0, debris_vertices = 0;
+        report("block lines", time_runs(runs, [&] {
+            line_vertices = 0;
+            for (const auto &line : lines) {
+                vertices.clear();
+                mesh_blocks(line, line.front().position, true, lookup, vertices);
+                line_vertices += vertices.size();
+            }
+        }));
+        report_vertices("", line_vertices, sizeof(VXLVertex), lines.size());
+        report("debris", time_runs(runs, [&] {
+            debris_vertices = 0;
+            for (const auto &fall : debris) {
+                vertices.clear();
+                mesh_blocks(fall, fall.front().position, false, lookup, vertices);
+                debris_vertices += vertices.size();
+            }
+        }));
+        report_vertices("", debris_vertices, sizeof(VXLVertex), debris.size());
+
+#ifdef ACE_MESH_BENCH_GL
+        if (use_gl) gl_bench(runs, greedy.meshes);
+#endif
+    }
+
+    for (const auto &path : models) {
+        fmt::print("{} ({} runs)\n", path, runs);
+        size_t count = 0;
+        std::vector<::detail::KV6Vertex> vertices;
+        // what KV6Mesh does before it uploads anything
+        report("kv6", time_runs(runs, [&] {
+            const KV6Data data(path);
+            vertices.clear();
+            data.gen_vertices(vertices);
+            count = vertices.size();
+        }));
+        report_vertices("", count, sizeof(::detail::KV6Vertex), 1);
+    }
+    return 0;
+}
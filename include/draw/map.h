@@ -1,28 +1,23 @@
 #pragma once
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "glad/glad.h"
 #include "glm/glm.hpp"
 
 #include "scene/scene.h"
+#include "draw/mesher.h"
 #include "draw/sprite.h"
 #include "gl/shader.h"
 #include "gl/gl_util.h"
+#include "util/range_allocator.h"
+#include "util/worker_pool.h"
 #include "vxl.h"
 
 
 namespace ace { namespace draw {
-    namespace detail {
-#pragma pack(push, 1)
-        struct VXLVertex {
-            glm::vec3 vertex;
-            glm::vec3 color;
-            GLubyte face;
-        };
-#pragma pack(pop)
-    }
-    constexpr size_t PILLAR_SIZE = 16;
-
     constexpr bool valid_build_pos(const int x, const int y, const int z) {
         return z < MAP_Z - 2 && is_valid_pos(x, y, z);
     }
@@ -47,29 +42,66 @@ namespace ace { namespace draw {
         glm::vec3 scale, rotation, position, centroid;
 
     private:
-        static uint8_t get_vis(std::unordered_set<glm::ivec3> &set, glm::ivec3 pos);
+        // scratch for mesh_blocks
+        std::vector<glm::ivec3> lookup;
+    };
+
+    struct DrawMap;
+
+    struct SubChunk {
+        // draw space bounds of the quads in this chunk
+        glm::vec3 min, max;
+        size_t first{ 0 }, count{ 0 };
+        gl::query query;
+        bool query_pending{ false };
+        // result of the last finished occlusion query
+        bool occluded{ false };
     };
 
     struct Pillar {
-        Pillar(AceMap &map, size_t x, size_t y);
+        Pillar(size_t x, size_t y) : dirty(true), x(x), y(y) { }
 
-        void update();
-        void draw();
+        // write the mesh into its range of the shared vertex buffer, which has to be allocated already
+        void upload(detail::PillarMesh &mesh, gl::experimental::vbo<detail::VXLVertex> &buffer);
+        // rewrite the faces of a few voxels in place, false if the result doesn't fit in its range and it needs a rebuild
+        bool patch(DrawMap &map, const std::vector<glm::ivec3> &voxels);
 
         bool contains(glm::vec3 pos) const {
             return this->x <= pos.x && pos.x <= this->x + PILLAR_SIZE && this->y <= pos.y && pos.y <= this->y + PILLAR_SIZE;
         }
 
         bool dirty;
-        AceMap &map;
+        // a worker is meshing this pillar, the current mesh keeps being drawn until it's done
+        bool building{ false };
+        // meshed one quad per voxel face so it can be patched
+        bool per_voxel{ false };
+        // has been patched recently, so it stays per voxel even with greedy meshing until the edits stop for a bit
+        bool edited{ false };
+        double last_edit{ 0 };
         size_t x, y;
-        gl::experimental::vao vao;
-        gl::experimental::vbo<detail::VXLVertex> vbo{GL_DYNAMIC_DRAW};
+        size_t quads{ 0 };
+        // range of DrawMap::vertices owned by this pillar, in quads
+        size_t offset{ 0 }, capacity{ 0 };
+        // same for the lod meshes, which don't get patched so they're stale until the next rebuild
+        size_t lod_offset[LOD_LEVELS]{}, lod_quads[LOD_LEVELS]{};
+        bool lod_dirty{ true };
+        // voxels changed since the last frame (wrapped map coords)
+        std::vector<glm::ivec3> pending;
+        // after a patch the quads aren't sorted anymore, so the whole pillar is in the first one
+        SubChunk chunks[SUBCHUNKS];
+
+    private:
+        void remove_quad(gl::experimental::vbo<detail::VXLVertex> &buffer, uint32_t slot);
+
+        // face key of every quad in the vbo, and the reverse lookup which is only built once the pillar gets patched
+        std::vector<uint32_t> faces;
+        std::unordered_map<uint32_t, uint32_t> slots;
     };
 
     struct DrawMap : AceMap {
         DrawMap(scene::GameScene &s, const std::string &file_path);
         DrawMap(scene::GameScene &s, uint8_t *buf = nullptr);
+        DrawMap(scene::GameScene &s, AceMap &&map);
 
         void update(double dt);
         void draw(gl::ShaderProgram &shader);
@@ -79,6 +111,11 @@ namespace ace { namespace draw {
         bool destroy_point(int x, int y, int z, std::vector<VXLBlock> &destroyed);
         bool damage_point(int x, int y, int z, uint8_t damage);
 
+        // set_point between these only changes the map and remembers what it touched, the pillars, lighting and minimap
+        // are updated once for all of it on commit. they nest, only the outermost commit does anything
+        void begin_edit() { this->edit_depth++; }
+        void commit_edit();
+
         static glm::ivec3 next_block(int x, int y, int z, Face face) {
             glm::ivec3 pos;
             switch(face) {
@@ -109,13 +146,91 @@ namespace ace { namespace draw {
         }
 
         Pillar &get_pillar(int x, int y, int z = 0);
+        void set_greedy_meshing(bool greedy);
+
+        // same as AceMap::sunblock, but kept up to date by set_point instead of walking the map every time
+        uint8_t get_light(int x, int y, int z) const {
+            return this->light[get_pos(x & (MAP_X - 1), y & (MAP_Y - 1), z)];
+        }
 
         draw::SpriteGroup *get_overview();
 
         scene::GameScene &scene;
         std::vector<Pillar> pillars;
         std::vector<std::pair<double, glm::ivec3>> damage_queue;
+        // merge coplanar faces of the same color into bigger quads instead of one quad per voxel face
+        bool greedy_meshing{ true };
+        // seconds without edits before a patched pillar gets meshed greedily again
+        double greedy_after_edit{ 5.0 };
+        // finished meshes uploaded per frame, the rest wait for the next frame
+        int mesh_uploads_per_frame{ 16 };
+        // skip sub chunks whose bounding box was hidden last frame
+        bool occlusion_culling{ true };
+        // fast demo playback: every frame waits for the meshes and occlusion queries of the last one (instead of
+        // using whatever is back yet) so the same demo always draws the same thing
+        bool deterministic{ false };
+        // pillars further than this use the 2x lod mesh, and the 4x one past 1.5 times this. 0 turns lod off
+        float lod_distance{ 64 };
     private:
+        friend struct Pillar;
+
+        // same layout as DrawElementsIndirectCommand
+        struct DrawCommand {
+            GLuint count, instance_count, first_index;
+            GLint base_vertex;
+            GLuint base_instance;
+        };
+
         void gen_pillars();
+        void build_pillar(size_t index);
+        void upload_pillars();
+        void patch_pillars();
+        // shape = solid changed, not just the color
+        void queue_patch(int x, int y, int z, bool shape);
+        void gen_light();
+        void reserve_quads(size_t quads);
+        // gives the pillar a range of the vertex buffer big enough for quads, growing it if needed
+        void allocate_pillar(Pillar &p, size_t quads);
+        size_t allocate_quads(size_t quads);
+        void upload_lods(Pillar &p, detail::PillarMesh &mesh);
+        float pillar_distance(const Pillar &p) const;
+        // 0 for the full mesh, otherwise the lod level + 1
+        int pillar_lod(float distance) const;
+        // offset is where the pillar's mesh starts in vertices, first and count are relative to it
+        void queue_draw(const Pillar &p, size_t offset, size_t first, size_t count);
+        void submit_draws();
+        bool chunk_visible(SubChunk &chunk);
+        void test_occlusion(gl::ShaderProgram &shader);
+
+        // every pillar mesh lives in one big buffer drawn through a single VAO, with ranges handed out by the allocator
+        gl::experimental::vao vao;
+        gl::experimental::vbo<detail::VXLVertex> vertices{ GL_DYNAMIC_DRAW };
+        util::RangeAllocator allocator;
+        // every mesh is a plain list of quads, so they can all share one index buffer
+        gl::experimental::ebo<GLuint> quad_indices;
+        // the visible ranges of this frame, with the pillar position of each one (an instanced attribute, picked by base_instance)
+        gl::experimental::vbo<DrawCommand, GL_DRAW_INDIRECT_BUFFER> draw_commands{ GL_STREAM_DRAW };
+        gl::experimental::vbo<glm::vec3> draw_origins{ GL_STREAM_DRAW };
+        // glMultiDrawElementsIndirect needs 4.3, otherwise every range is its own draw call
+        bool multi_draw_indirect{ false };
+        std::vector<size_t> patch_queue;
+        std::vector<uint8_t> light;
+
+        struct Edit {
+            glm::ivec3 pos;
+            // from before the first change to it in this batch
+            bool was_solid;
+        };
+        int edit_depth{ 0 };
+        std::vector<Edit> edits;
+        // unit cube for occlusion queries
+        gl::experimental::vao box_vao;
+        gl::experimental::vbo<detail::VXLVertex> box_vbo;
+        std::vector<SubChunk *> occlusion_tests;
+
+        std::mutex finished_lock;
+        std::vector<std::unique_ptr<detail::PillarMesh>> finished;
+        // declared last so the workers are stopped before anything they touch is destroyed
+        util::WorkerPool workers;
     };
 }}
\ No newline at end of file
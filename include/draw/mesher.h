@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "vxl.h"
+
+// everything that turns the map into vertices, no GL in here so it runs on the mesh workers and in bench/mesh_bench
+namespace ace { namespace draw {
+    // pillars are drawn and culled in vertical slices of this many blocks
+    constexpr int SUBCHUNK_Z = 16;
+    constexpr int SUBCHUNKS = MAP_Z / SUBCHUNK_Z;
+    // far away pillars are drawn from heightfields of 2x2 and 4x4 columns
+    constexpr int LOD_LEVELS = 2;
+    constexpr size_t PILLAR_SIZE = 16;
+
+    namespace detail {
+#pragma pack(push, 1)
+        struct VXLVertex {
+            // draw space x in bits 0-9, y in 10-17 and z in 18-27 (signed), the face in the top 4 bits (28-31), see map.vert
+            uint32_t position;
+            // rgb + shade (sunblock * health) in alpha, 127 is fully lit
+            glm::u8vec4 color;
+        };
+#pragma pack(pop)
+
+        // CPU side result of meshing a pillar on a worker thread, every 4 vertices are one quad
+        struct PillarMesh {
+            size_t index;
+            bool per_voxel;
+            std::vector<VXLVertex> vertices;
+            // face key (local voxel index * 8 + face) of every quad, only for per voxel meshes
+            std::vector<uint32_t> faces;
+            // quads are sorted by sub chunk, with pillar local bounds for each
+            size_t chunk_quads[SUBCHUNKS];
+            glm::vec3 chunk_min[SUBCHUNKS], chunk_max[SUBCHUNKS];
+            // empty if lod is off
+            std::vector<VXLVertex> lods[LOD_LEVELS];
+        };
+
+        inline VXLVertex make_vertex(const int x, const int y, const int z, const Face face, const glm::u8vec4 color) {
+            return { uint32_t(x & 0x3FF) | uint32_t(y & 0xFF) << 10 | uint32_t(z & 0x3FF) << 18 | uint32_t(face) << 28, color };
+        }
+
+        inline glm::ivec3 vertex_position(const VXLVertex &v) {
+            return { int32_t(v.position << 22) >> 22, int32_t(v.position << 14) >> 24, int32_t(v.position << 4) >> 22 };
+        }
+
+        inline bool ivec3_less(const glm::ivec3 &a, const glm::ivec3 &b) {
+            return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+        }
+
+        constexpr uint32_t face_key(const int lx, const int ly, const int z, const int face) {
+            return ((lx * PILLAR_SIZE + ly) * MAP_Z + z) * 8 + face;
+        }
+
+        // solid bits of the columns around a pillar (bit n = z n) with one column of padding on every side for face visibility.
+        // copied on the main thread so workers never touch the live map.
+        constexpr int SNAPSHOT_X0 = -1, SNAPSHOT_Y0 = -1;
+        constexpr int SNAPSHOT_W = int(PILLAR_SIZE) + 2, SNAPSHOT_L = int(PILLAR_SIZE) + 2;
+
+        struct PillarSnapshot {
+            size_t index;
+            bool per_voxel, lods;
+            uint64_t solid[SNAPSHOT_W * SNAPSHOT_L];
+            // only filled in for voxels with at least one visible face
+            uint32_t colors[PILLAR_SIZE * PILLAR_SIZE * MAP_Z];
+            uint8_t light[PILLAR_SIZE * PILLAR_SIZE * MAP_Z];
+
+            // copy the pillar at (x, y) out of the map, light is laid out like the map (see gen_light).
+            // get_color can assign new colors, so this has to be called from whatever thread owns the map
+            void copy(AceMap &map, const std::vector<uint8_t> &light, int x, int y);
+
+            uint64_t column(int lx, int ly) const {
+                return this->solid[(lx - SNAPSHOT_X0) * SNAPSHOT_L + ly - SNAPSHOT_Y0];
+            }
+
+            uint64_t &column(int lx, int ly) {
+                return this->solid[(lx - SNAPSHOT_X0) * SNAPSHOT_L + ly - SNAPSHOT_Y0];
+            }
+
+            // AceMap::get_column_vis on the copied columns
+            void column_vis(int lx, int ly, uint64_t (&faces)[6]) const {
+                const uint64_t c = this->column(lx, ly);
+                faces[int(Face::LEFT)] = c & ~this->column(lx - 1, ly);
+                faces[int(Face::RIGHT)] = c & ~this->column(lx + 1, ly);
+                faces[int(Face::BACK)] = c & ~this->column(lx, ly - 1);
+                faces[int(Face::FRONT)] = c & ~this->column(lx, ly + 1);
+                faces[int(Face::TOP)] = c & ~(c << 1);
+                faces[int(Face::BOTTOM)] = c & ~(c >> 1);
+            }
+        };
+
+        // 6 vertices (2 triangles) for every face in vis
+        void gen_faces(int x, int y, int z, uint8_t vis, glm::u8vec4 color, std::vector<VXLVertex> &v);
+        // same corners and winding as gen_faces, but as 4 vertices (see DrawMap::reserve_quads) so quads can span multiple voxels
+        void gen_quad(Face face, int x0, int x1, int y0, int y1, int z0, int z1, glm::u8vec4 color, std::vector<VXLVertex> &v);
+
+        // what the mesh workers do: greedy or per voxel depending on the snapshot, split into sub chunks, plus the lods
+        void mesh_pillar(const PillarSnapshot &snapshot, PillarMesh &mesh);
+
+        // sunblock of every voxel, indexed with get_pos. 127 is fully lit
+        void gen_light(const AceMap &map, std::vector<uint8_t> &light);
+
+        // faces of pos not covered by another block in sorted (see ivec3_less)
+        uint8_t block_vis(const std::vector<glm::ivec3> &sorted, glm::ivec3 pos);
+        // triangles for loose blocks (ghost blocks, debris) relative to origin. with gen_vis the faces come from
+        // the blocks themselves instead of VXLBlock::vis, lookup is scratch space for that
+        void mesh_blocks(const std::vector<VXLBlock> &blocks, glm::ivec3 origin, bool gen_vis, std::vector<glm::ivec3> &lookup, std::vector<VXLVertex> &v);
+    }
+}}
@@ -7,6 +7,8 @@
 #include "sound/sound.h"
 #include "draw/font.h"
 #include "util/event.h"
+#include "util/frame_stats.h"
+#include "util/profiler.h"
 #include "net/net.h"
 #include "net/url.h"
 #include "draw/sprite.h"
@@ -27,6 +29,8 @@ namespace ace {
         GameConfig(std::string file_name);
 
         SDL_Scancode get_key(const std::string &key);
+        // fallback instead of throwing if key isn't bound
+        SDL_Scancode get_key(const std::string &key, SDL_Scancode fallback);
 
         nlohmann::json json;
     private:
@@ -87,6 +91,8 @@ namespace ace {
         util::TaskScheduler tasks;
         draw::FontManager fonts;
         GameConfig config;
+        util::Profiler profiler;
+        util::FrameStats frame_stats;
 
         // Input state
         struct {
@@ -106,7 +112,7 @@ namespace ace {
 
         std::unique_ptr<scene::Scene> scene; // very bad idea??
     private:
-        void draw() const;
+        void draw();
         void update(double dt);
         void update_fps();
 
@@ -58,11 +58,15 @@ namespace ace { namespace gl {
 
         inline auto gen_textures(GLsizei n, GLuint *handles) { return glGenTextures(n, handles); }
         inline auto del_textures(GLsizei n, const GLuint *handles) { return glDeleteTextures(n, handles); }
+
+        inline auto gen_queries(GLsizei n, GLuint *handles) { return glGenQueries(n, handles); }
+        inline auto del_queries(GLsizei n, const GLuint *handles) { return glDeleteQueries(n, handles); }
     }
 
     using vao = GLObj<detail::gen_vertex_arrays, detail::delete_vertex_arrays>;
     using vbo = GLObj<detail::gen_buffers, detail::del_buffers>;
     using texture = GLObj<detail::gen_textures, detail::del_textures>;
+    using query = GLObj<detail::gen_queries, detail::del_queries>;
 
     namespace experimental {
         struct vao {
@@ -74,6 +78,19 @@ namespace ace { namespace gl {
                 glDrawArrays(mode, first, count);
             }
 
+            void draw_elements(GLenum mode, GLsizei count, GLenum type = GL_UNSIGNED_INT, size_t first = 0) const {
+                if (count == 0) return;
+                this->bind();
+                glDrawElements(mode, count, type, reinterpret_cast<void *>(first));
+            }
+
+            // element buffer binding is part of the VAO state, so this only has to be done once
+            vao &element_buffer(const gl::vbo &buffer) {
+                this->bind();
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+                return *this;
+            }
+
             void draw_instanced(GLenum mode, GLsizei count, GLsizei instance_count, GLint first = 0) const {
                 this->bind();
                 glDrawArraysInstanced(mode, first, count, instance_count);
@@ -88,26 +105,63 @@ namespace ace { namespace gl {
         };
 
 
-        template<typename T>
+        template<typename T, GLenum Target = GL_ARRAY_BUFFER>
         struct vbo {
             explicit vbo(GLenum usage = GL_STATIC_DRAW) : usage(usage) {
 
             }
 
             void upload() {
-                if (this->data.empty()) return;
+                if (this->data.empty()) {
+                    this->draw_count = 0;
+                    return;
+                }
 
-                glBindBuffer(GL_ARRAY_BUFFER, this->handle);
+                glBindBuffer(Target, this->handle);
                 if(GLAD_GL_VERSION_4_3) {
                     glInvalidateBufferData(this->handle);
                 }
                 this->draw_count = this->data.size();
                 this->vbo_size = this->data.capacity() * sizeof(T);
-                glBufferData(GL_ARRAY_BUFFER, this->vbo_size, nullptr, this->usage);
-                glBufferSubData(GL_ARRAY_BUFFER, 0, this->draw_count * sizeof(T), this->data.data());
+                glBufferData(Target, this->vbo_size, nullptr, this->usage);
+                glBufferSubData(Target, 0, this->draw_count * sizeof(T), this->data.data());
                 this->data.clear();
             }
 
+            // overwrite count elements starting at offset (in elements), has to fit in what was last uploaded
+            void update(size_t offset, const T *data, size_t count) {
+                glBindBuffer(Target, this->handle);
+                glBufferSubData(Target, offset * sizeof(T), count * sizeof(T), data);
+            }
+
+            // copy count elements inside the buffer, the ranges can't overlap
+            void copy(size_t from, size_t to, size_t count) {
+                glBindBuffer(GL_COPY_READ_BUFFER, this->handle);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, this->handle);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from * sizeof(T), to * sizeof(T), count * sizeof(T));
+            }
+
+            // grow the buffer to hold count elements and keep what's in it,
+            // goes through a temporary buffer so the handle (and every VAO pointing at it) stays the same
+            void reserve(size_t count) {
+                const size_t size = count * sizeof(T);
+                if (size <= this->vbo_size) return;
+
+                gl::vbo temp;
+                if (this->vbo_size != 0) {
+                    glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+                    glBufferData(GL_COPY_WRITE_BUFFER, this->vbo_size, nullptr, GL_STREAM_COPY);
+                    glBindBuffer(GL_COPY_READ_BUFFER, this->handle);
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, this->vbo_size);
+                }
+                glBindBuffer(GL_COPY_READ_BUFFER, this->handle);
+                glBufferData(GL_COPY_READ_BUFFER, size, nullptr, this->usage);
+                if (this->vbo_size != 0) {
+                    glCopyBufferSubData(GL_COPY_WRITE_BUFFER, GL_COPY_READ_BUFFER, 0, 0, this->vbo_size);
+                }
+                this->vbo_size = size;
+            }
+
             std::vector<T> *operator->() { return &this->data; }
 
             gl::vbo handle;
@@ -117,6 +171,10 @@ namespace ace { namespace gl {
             GLsizei draw_count{};
         };
 
+        // index buffer, the VAO it's attached to has to be bound when uploading
+        template<typename T>
+        using ebo = vbo<T, GL_ELEMENT_ARRAY_BUFFER>;
+
         template<typename T>
         struct streaming_vbo : vbo<T> {
             streaming_vbo() : vbo<T>(GL_STREAM_DRAW) {
@@ -171,11 +229,8 @@ namespace ace { namespace gl {
                     throw std::out_of_range(fmt::format("x: {}/y: {} out of range ({}, {})", x, y, this->width, this->height));
                 }
 
-                this->lower = glm::min(this->lower, { x, y });
-                this->upper = glm::max(this->upper, { x + 1, y + 1 });
-
-                this->_pixels[y * this->height + x] = pixel;
-                this->dirty = true;
+                this->_pixels[y * this->width + x] = pixel;
+                this->mark_dirty(x, y, x + 1, y + 1);
             }
 
             void set_pixel(int x, int y, glm::u8vec4 pixel) {
@@ -186,7 +241,7 @@ namespace ace { namespace gl {
                 if (x < 0 || y < 0 || x >= this->width || y >= this->height) {
                     throw std::out_of_range(fmt::format("x: {}/y: {} out of range ({}, {})", x, y, this->width, this->height));
                 }
-                return this->_pixels[y * this->height + x];
+                return this->_pixels[y * this->width + x];
             }
 
             glm::u8vec4 get_pixel(int x, int y) const {
@@ -207,22 +262,19 @@ namespace ace { namespace gl {
                 glTexParameteri(texture2d::target, GL_TEXTURE_MAG_FILTER, mode);
             }
 
-            void upload() {
-                if(!this->dirty) {
-                    return;
-                }
-                // tTODO mipmap support, region updating
-                this->bind(false);
-                glTexSubImage2D(texture2d::target, 0, 0, 0, this->width, this->height, texture2d::gl_format, GL_UNSIGNED_BYTE, this->_pixels.get());
-                this->dirty = false;
-            }
+            // only sends the rects that changed since the last upload
+            void upload();
 
             void full_upload() {
                 this->bind(false);
                 glTexImage2D(texture2d::target, 0, texture2d::gl_format, this->width, this->height, 0, texture2d::gl_format, GL_UNSIGNED_BYTE, this->_pixels.get());
-                this->dirty = false;
+                this->dirty_rects = 0;
+                this->allocated = true;
             }
 
+            // pixels in [x1, x2) x [y1, y2) changed and need to be uploaded
+            void mark_dirty(int x1, int y1, int x2, int y2);
+
             void bind(bool update = true) {
                 glBindTexture(texture2d::target, this->handle);
                 if(update) this->upload();
@@ -233,7 +285,8 @@ namespace ace { namespace gl {
 
             // use .get() or use a const reference if you're gonna read often but not write because this marks the texture to be updated
             pixel_type &operator[](const size_t index) {
-                this->dirty = true;
+                const int x = int(index % this->width), y = int(index / this->width);
+                this->mark_dirty(x, y, x + 1, y + 1);
                 return this->_pixels[index];
             }
 
@@ -244,12 +297,20 @@ namespace ace { namespace gl {
             const pixel_type *get() const { return this->_pixels.get(); }
 
             gl::texture handle;
+            // stream the dirty rects through a pixel buffer instead of straight from _pixels, so the copy doesn't stall
+            bool use_pbo{ false };
         private:
+            static constexpr int MAX_DIRTY_RECTS = 8;
+
             int width, height;
             std::unique_ptr<pixel_type[]> _pixels;
-            bool dirty = true;
+            // no glTexImage2D yet, the first upload has to send everything
+            bool allocated = false;
 
-            glm::ivec2 lower, upper;
+            // x1, y1, x2, y2. a few separate ones so edits on opposite sides of the texture don't turn into one big upload
+            glm::ivec4 dirty_rect[MAX_DIRTY_RECTS];
+            int dirty_rects = 0;
+            gl::vbo pbo;
         };
     }
 }}
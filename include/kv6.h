@@ -5,19 +5,10 @@
 #include "glad/glad.h"
 
 #include "common.h"
+#include "kv6_data.h"
 #include "gl/shader.h"
 #include "gl/gl_util.h"
 
-namespace detail {
-#pragma pack(push, 1)
-    struct KV6Vertex {
-        glm::vec3 vertex;
-        glm::vec3 color;
-        glm::vec3 normal; // face normal
-        glm::vec3 kv6norm; // kv6 normal
-    };
-#pragma pack(pop)
-}
 
 struct KV6Mesh {
     KV6Mesh(const std::string &name);
@@ -40,6 +31,8 @@ struct KV6 {
     }
 
     bool sprhitscan(glm::vec3 p0, glm::vec3 v0, glm::vec3 *h);
+    // same thing with get_model() and its inverse already worked out
+    bool sprhitscan(glm::vec3 p0, glm::vec3 v0, glm::vec3 *h, const glm::mat4 &model, const glm::mat4 &inverse) const;
 
     glm::mat4 get_model() const {
         return ace::model_matrix(position, rotation, scale);
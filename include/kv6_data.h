@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace detail {
+#pragma pack(push, 1)
+    struct KV6Vertex {
+        glm::vec3 vertex;
+        glm::vec3 color;
+        glm::vec3 normal; // face normal
+        glm::vec3 kv6norm; // kv6 normal
+    };
+#pragma pack(pop)
+}
+
+// a .kv6 file as it is on disk, no GL needed. KV6Mesh turns it into something drawable
+struct KV6Data {
+    explicit KV6Data(const std::string &name);
+
+    // 6 vertices for every visible face, appended to v
+    void gen_vertices(std::vector<detail::KV6Vertex> &v) const;
+
+    struct Voxel {
+        uint8_t r, g, b, vis, normal;
+        uint16_t height;
+    };
+
+    int32_t xsiz, ysiz, zsiz, num_voxels;
+    float xpiv, ypiv, zpiv;
+    std::vector<Voxel> voxels;
+    // how many voxels each (x, y) column has, x major
+    std::vector<uint16_t> xyoffset;
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+typedef struct gzFile_s *gzFile;
+
+namespace ace { namespace net {
+    // a demo is every packet the server sent, with when it arrived. the file is gzip'd, inside is "ACEDEMO",
+    // a version byte, the random seed (4 bytes, little endian) and then one record per packet:
+    // varint us since the previous one, varint length, the packet
+    constexpr uint8_t DEMO_VERSION = 2;
+
+    struct DemoRecorder {
+        explicit DemoRecorder(const std::string &file_path);
+        ~DemoRecorder();
+        ACE_NO_COPY_MOVE(DemoRecorder)
+
+        void record(const uint8_t *data, size_t len);
+
+        // the game gets seeded with this while recording and again for playback, so dirt colors and such come out the same
+        const uint32_t seed;
+        size_t packets{ 0 };
+    private:
+        gzFile file;
+        std::chrono::steady_clock::time_point last;
+        // varints of the record being written
+        std::vector<uint8_t> scratch;
+    };
+
+    struct DemoPlayer {
+        // demo time every frame gets in fast playback, no matter how long the frame really took
+        static constexpr double FAST_STEP = 1.0 / 60.0;
+
+        struct Packet {
+            // seconds since the start of the demo
+            double time;
+            size_t offset, len;
+        };
+
+        // the whole demo is read up front, playback shouldn't be waiting on the disk
+        DemoPlayer(const std::string &file_path, bool fast);
+
+        void start();
+        // moves the demo clock forward by dt (or FAST_STEP)
+        void advance(double dt);
+        // the next packet that's due, nullptr if there isn't one yet
+        const Packet *poll();
+        bool done() const { return this->next == this->packets.size(); }
+
+        uint8_t *data(const Packet &packet) { return this->buf.data() + packet.offset; }
+        double duration() const { return this->packets.empty() ? 0 : this->packets.back().time; }
+        // seconds since start()
+        double wall_time() const;
+
+        const bool fast;
+        uint32_t seed{ 0 };
+        double time{ 0 };
+        uint64_t frames{ 0 };
+        std::vector<Packet> packets;
+    private:
+        std::vector<uint8_t> buf;
+        size_t next{ 0 };
+        std::chrono::steady_clock::time_point started;
+    };
+}}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "common.h"
+
+struct z_stream_s;
+
+namespace ace { namespace net {
+    std::vector<uint8_t> inflate(uint8_t *data, size_t len, size_t initial_size = 2 << 16);
+
+    // zlib inflater that can be fed one piece of the compressed stream at a time
+    struct StreamInflater {
+        StreamInflater();
+        ~StreamInflater();
+        ACE_NO_COPY_MOVE(StreamInflater)
+
+        // returns everything that could be decompressed from this piece, valid until the next call
+        const std::vector<uint8_t> &feed(const uint8_t *data, size_t len);
+
+        bool finished{ false };
+    private:
+        std::unique_ptr<z_stream_s> stream;
+        std::vector<uint8_t> output;
+    };
+}}
@@ -2,13 +2,15 @@
 #include "util/except.h"
 #include "enet/enet.h"
 
+#include "net/demo.h"
+#include "net/inflate.h"
 #include "net/packet.h"
 #include "common.h"
+#include "vxl.h"
 
 namespace ace { class GameClient; }
 
 namespace ace { namespace net {
-    std::vector<uint8_t> inflate(uint8_t *data, size_t len, size_t initial_size = 2 << 16);
 
     enum class NetState {
         UNCONNECTED,
@@ -60,9 +62,9 @@ namespace ace { namespace net {
         virtual ~BaseNetClient();
         ACE_NO_COPY_MOVE(BaseNetClient)
 
-        void update(double dt);
+        virtual void update(double dt);
         void connect(const char *host, int port, uint32_t data=0);
-        void disconnect();
+        virtual void disconnect();
         void send(const void *data, size_t len, enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE) const;
 
         virtual void on_connect(const ENetEvent &event) = 0;
@@ -83,6 +85,13 @@ namespace ace { namespace net {
 
 //        using BaseNetClient::connect;
         void connect(const Server &server);
+        void update(double dt) final;
+        void disconnect() final;
+
+        // the next connect() records everything the server sends to file_path
+        void record_demo(std::string file_path) { this->demo_path = std::move(file_path); }
+        // the next connect() plays the demo back instead, nothing is sent anywhere until it's over
+        void play_demo(const std::string &file_path, bool fast);
 
         void on_connect(const ENetEvent& event) final;
         void on_disconnect(const ENetEvent& event) final;
@@ -101,8 +110,15 @@ namespace ace { namespace net {
         // }
         
         ByteWriter map_writer;
+        // map chunks are inflated and decoded as they arrive so the map is ready when StateData is
+        std::unique_ptr<StreamInflater> map_inflater;
+        std::unique_ptr<VXLStreamReader> map_reader;
         std::vector<net::ExistingPlayer> players;
 
+        std::string demo_path;
+        std::unique_ptr<DemoRecorder> recorder;
+        std::unique_ptr<DemoPlayer> demo;
+
         ace::GameClient &client;
 
 //        bool connected;
@@ -110,6 +126,7 @@ namespace ace { namespace net {
         NetState state;
     private:
         void set_state(NetState state);
+        void end_demo();
     };
 
     inline const char *get_disconnect_reason(DISCONNECT reason) {
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <utility>
 
 #include "glm/glm.hpp"
@@ -9,6 +10,7 @@
 #include "world/world.h"
 #include "world/player.h"
 #include "world/entity.h"
+#include "world/ray_query.h"
 
 #include "draw/billboard.h"
 #include "draw/map.h"
@@ -50,13 +52,19 @@ namespace ace { namespace scene {
         glm::vec3 cam_right; float ___pad2;
         glm::vec3 cam_up; float ___pad3;
         glm::vec3 fog_color; float ___pad4;
-        glm::vec3 light_pos; float ___pad5;
+        // std140 puts a float right after a vec3, so fog_start fills the rest of light_pos's 16 bytes
+        glm::vec3 light_pos;
+        // fog goes from nothing at fog_start to only fog at fog_end
+        float fog_start, fog_end; float ___pad5[3];
     };
 #pragma pack(pop)
+    static_assert(offsetof(SceneUniforms, fog_start) == 268, "fog_start has to line up with the std140 layout in the shaders");
+    static_assert(sizeof(SceneUniforms) == 288, "SceneUniforms has to match the std140 block size");
 
     class GameScene final : public Scene {
     public:
         GameScene(GameClient &client, const net::StateData &state_data, std::string ply_name="Deuce", uint8_t *buf=nullptr);
+        GameScene(GameClient &client, const net::StateData &state_data, std::string ply_name, std::unique_ptr<AceMap> vxl);
         // GameScene(GameClient& client, const std::string& map_name);
         ~GameScene();
 
@@ -81,6 +89,8 @@ namespace ace { namespace scene {
 
         void set_zoom(bool zoom);
         void set_fog_color(glm::vec3 color);
+        // also the far plane, DrawMap doesn't draw pillars past it
+        void set_fog_distance(float distance);
 
         void send_block_action(int x, int y, int z, net::ACTION type = net::ACTION::BUILD) const;
         void send_block_line(glm::ivec3 p1, glm::ivec3 p2) const;
@@ -112,6 +122,7 @@ namespace ace { namespace scene {
         net::StateData state_data;
 
         bool thirdperson{};
+        float fog_distance{ 128 };
 
         std::unordered_map<int, std::unique_ptr<world::DrawPlayer>> players;
         std::unordered_map<int, glm::u8vec3> block_colors;
@@ -120,6 +131,7 @@ namespace ace { namespace scene {
         std::unordered_map<uint8_t, std::unique_ptr<world::Entity>> entities;
         std::vector<std::unique_ptr<world::WorldObject>> objects;
         std::vector<std::unique_ptr<world::WorldObject>> queued_objects;
+        world::RayQuery rays{ *this };
 
         world::DrawPlayer *get_ply(int pid, bool create = true, bool local_player = false) {
             auto ply = players.find(pid);
@@ -4,6 +4,7 @@
 #include "scene/scene.h"
 #include "draw/sprite.h"
 #include "draw/font.h"
+#include "draw/debug.h"
 #include "world/player.h"
 
 namespace ace { namespace scene {
@@ -60,6 +61,8 @@ namespace ace { namespace scene {
         glm::mat4 projection;
 
         MapDisplay map_display;
+        // the profiler overlay graph, in screen space
+        draw::DebugDraw profiler_lines;
         
         world::DrawPlayer ply;
 
@@ -78,6 +81,7 @@ namespace ace { namespace scene {
         void update_color(SDL_Scancode key);
 
         void draw_chat();
+        void draw_profiler();
         void draw_scoreboard();
 
         net::CHAT cur_chat_type{ net::CHAT::INVALID };
@@ -24,6 +24,7 @@ namespace ace { namespace scene {
 //        using Scene::Scene;
 //        LoadingScene(GameClient &client, const char *host, int port);
         LoadingScene(GameClient &client, const std::string &address);
+        LoadingScene(GameClient &client, net::Server server);
         ~LoadingScene();
 
         void draw() override;
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ace { namespace util {
+    // every frame time goes into a fixed histogram for percentiles. frames a lot slower than the median are kept
+    // as spikes, with whatever was counted during them (pillar rebuilds, packets...) so hitches can be explained
+    class FrameStats {
+    public:
+        // 0.25 ms buckets up to 250 ms, anything slower goes in the last one
+        static constexpr int BUCKETS = 1000;
+        static constexpr double BUCKET_MS = 0.25;
+        static constexpr size_t MAX_SPIKES = 4096;
+        // slower than this times the median is a spike
+        static constexpr double SPIKE_FACTOR = 2.0;
+
+        struct Spike {
+            uint64_t frame;
+            // seconds since the first frame
+            double time, ms;
+            std::vector<std::pair<const char *, int>> counters;
+        };
+
+        // add n to a counter of the current frame, names have to be string literals
+        void count(const char *name, int n = 1);
+        // overwrite a counter of the current frame, for things like how many objects are alive
+        void set(const char *name, int n);
+        // the current frame took ms, counters start over
+        void end_frame(double ms);
+
+        // frame time that p (0-1) of all frames were at or under, the upper edge of its bucket
+        double percentile(double p) const;
+        double max() const { return this->max_ms; }
+        uint64_t frames() const { return this->total; }
+        const std::vector<Spike> &get_spikes() const { return this->spikes; }
+
+        // the histogram (ms, frames, fraction of frames at or under) and the spikes (one column per counter name)
+        bool write_csv(const std::string &histogram_path, const std::string &spikes_path) const;
+
+    private:
+        int &counter(const char *name);
+
+        uint32_t histogram[BUCKETS]{};
+        uint64_t total{ 0 };
+        double max_ms{ 0 }, time{ 0 };
+        // recalculated every so often, a spike has to be slower than SPIKE_FACTOR times this
+        double median{ 0 };
+        std::vector<std::pair<const char *, int>> counters;
+        std::vector<Spike> spikes;
+        uint64_t dropped_spikes{ 0 };
+    };
+}}
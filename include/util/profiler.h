@@ -0,0 +1,85 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "gl/gl_util.h"
+
+namespace ace { namespace util {
+    // nested named zones per frame, kept for the last MAX_FRAMES frames. gpu zones also get GL_TIMESTAMP queries
+    // around them, those come back a few frames later without stalling. main thread only
+    class Profiler {
+    public:
+        static constexpr int MAX_FRAMES = 240;
+
+        struct Zone {
+            // has to outlive the profiler, so string literals
+            const char *name;
+            int depth;
+            // us since the profiler was made
+            double start, end;
+            // index of the start query in Frame::queries (end is the one after it), -1 for cpu only zones
+            int query;
+            // ns, from the queries once they're back
+            int64_t gpu_start, gpu_end;
+        };
+
+        struct Frame {
+            uint64_t number{ 0 };
+            double start{ 0 }, end{ 0 };
+            std::vector<Zone> zones;
+            // GL clock at the start of the frame, lines the gpu zones up with the cpu ones
+            int64_t gpu_base{ 0 };
+            // still waiting on queries
+            bool gpu_pending{ false };
+            // reused every time this slot comes around, only grows
+            std::vector<gl::query> queries;
+            int used_queries{ 0 };
+        };
+
+        Profiler();
+
+        void begin_frame();
+        void end_frame();
+        void push(const char *name, bool gpu = false);
+        void pop();
+
+        // 0 is the last finished frame, nullptr if there isn't one that old
+        const Frame *frame(int age) const;
+
+        // chrome://tracing (or ui.perfetto.dev) json of every frame still kept, false if the file couldn't be opened
+        bool dump_trace(const std::string &file_path) const;
+
+        // nothing is recorded while this is off, takes effect on the next frame
+        bool enabled{ false };
+
+    private:
+        double now() const;
+        // false if the results aren't there yet and wait is false
+        bool read_queries(Frame &f, bool wait);
+
+        std::chrono::steady_clock::time_point epoch;
+        std::vector<Frame> frames;
+        // slot of the frame being recorded, finished frames are behind it
+        int current{ 0 };
+        uint64_t frame_count{ 0 };
+        bool recording{ false };
+        std::vector<int> stack;
+    };
+
+    struct ProfileZone {
+        ProfileZone(Profiler &profiler, const char *name, bool gpu = false) : profiler(profiler) {
+            profiler.push(name, gpu);
+        }
+
+        ~ProfileZone() {
+            this->profiler.pop();
+        }
+
+        ACE_NO_COPY_MOVE(ProfileZone)
+
+        Profiler &profiler;
+    };
+}}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <map>
+
+namespace ace { namespace util {
+    // hands out ranges of some buffer that lives elsewhere (first fit), freed neighbours get merged back together
+    class RangeAllocator {
+    public:
+        static constexpr size_t npos = SIZE_MAX;
+
+        explicit RangeAllocator(size_t size = 0) {
+            this->grow(size);
+        }
+
+        // offset of a free range of size units, npos if nothing fits
+        size_t allocate(size_t size) {
+            if (size == 0) return 0;
+
+            for (auto it = this->free_ranges.begin(); it != this->free_ranges.end(); ++it) {
+                if (it->second < size) continue;
+
+                const size_t offset = it->first, left = it->second - size;
+                this->free_ranges.erase(it);
+                if (left != 0) this->free_ranges.emplace(offset + size, left);
+                return offset;
+            }
+            return npos;
+        }
+
+        void free(size_t offset, size_t size) {
+            if (size == 0) return;
+
+            auto next = this->free_ranges.lower_bound(offset);
+            if (next != this->free_ranges.begin()) {
+                auto prev = std::prev(next);
+                if (prev->first + prev->second == offset) {
+                    offset = prev->first;
+                    size += prev->second;
+                    this->free_ranges.erase(prev);
+                }
+            }
+            if (next != this->free_ranges.end() && offset + size == next->first) {
+                size += next->second;
+                this->free_ranges.erase(next);
+            }
+            this->free_ranges.emplace(offset, size);
+        }
+
+        // add size units to the end
+        void grow(size_t size) {
+            this->free(this->total, size);
+            this->total += size;
+        }
+
+        size_t size() const { return this->total; }
+
+    private:
+        // offset -> size
+        std::map<size_t, size_t> free_ranges;
+        size_t total{ 0 };
+    };
+}}
@@ -0,0 +1,37 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+
+namespace ace { namespace util {
+    // a few threads that run jobs off the main thread, jobs still queued when it's destroyed are dropped
+    class WorkerPool {
+    public:
+        // threads = 0 uses one thread per hardware core minus the main thread
+        explicit WorkerPool(unsigned threads = 0);
+        ~WorkerPool();
+        ACE_NO_COPY_MOVE(WorkerPool)
+
+        void push(std::function<void()> job);
+        // blocks until every job pushed so far has finished
+        void wait();
+
+        size_t size() const { return this->threads.size(); }
+
+    private:
+        void run();
+
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        std::mutex lock;
+        std::condition_variable cv, idle;
+        // jobs taken off the queue that haven't finished yet
+        size_t running{ 0 };
+        bool stopping{ false };
+    };
+}}
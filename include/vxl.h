@@ -1,10 +1,10 @@
 #pragma once
-#include <bitset>
 #include <cstdint>
+#include <cstdlib>
+#include <memory>
 #include <vector>
 #include <random>
-#include <unordered_map>
-#include <unordered_set>
+#include <utility>
 
 #include "glm/glm.hpp"
 #include "glm/gtx/hash.hpp"
@@ -20,8 +20,10 @@ namespace ace {
     constexpr size_t MAP_Z = 64;
     constexpr uint32_t DEFAULT_COLOR = 0xFF674028;
 
+    // voxels are stored column-major: every z of a column is contiguous, so walking down a column
+    // (reading/writing spans, meshing, get_z) stays in the same cache lines.
     constexpr size_t get_pos(const int x, const int y, const int z) {
-        return x + (y * MAP_Y) + (z * MAP_X * MAP_Y);
+        return z + (x + y * MAP_X) * MAP_Z;
     }
 
     constexpr bool is_valid_pos(const int x, const int y, const int z) {
@@ -53,9 +55,11 @@ namespace ace {
     class AceMap {
     public:
         AceMap(uint8_t *buf = nullptr);
+        AceMap(AceMap &&) = default;
         virtual ~AceMap() = default;
 
-        void read(uint8_t *buf);
+        // threads = 0 decodes with one thread per hardware core
+        void read(uint8_t *buf, unsigned threads = 0);
         std::vector<uint8_t> write();
         size_t write(std::vector<uint8_t> &v, int *sx, int *sy, int columns = -1);
 
@@ -67,39 +71,95 @@ namespace ace {
         glm::ivec3 get_random_point(glm::ivec2 p1 = { 0, 0 }, glm::ivec2 p2 = { MAP_X, MAP_Y });
 
         std::vector<glm::ivec3> block_line(const glm::ivec3 start, const glm::ivec3 end) const {
-            return this->block_line(start.x, start.y, start.z, end.x, end.y, end.z);
+            std::vector<glm::ivec3> ret;
+            this->block_line(start, end, ret);
+            return ret;
         }
-        std::vector<glm::ivec3> block_line(int x1, int y1, int z1, int x2, int y2, int z2) const;
+        std::vector<glm::ivec3> block_line(int x1, int y1, int z1, int x2, int y2, int z2) const {
+            return this->block_line({ x1, y1, z1 }, { x2, y2, z2 });
+        }
+        // clears out and fills it, keep the same vector around and this stops allocating
+        void block_line(const glm::ivec3 start, const glm::ivec3 end, std::vector<glm::ivec3> &out) const {
+            out.clear();
+            this->block_line(start, end, [&out](const glm::ivec3 &c) { out.push_back(c); });
+        }
+        // calls visit(glm::ivec3) for every block on the line in order, no allocation at all
+        template<typename F>
+        void block_line(const glm::ivec3 start, const glm::ivec3 end, F &&visit) const {
+            this->block_line(start.x, start.y, start.z, end.x, end.y, end.z, std::forward<F>(visit));
+        }
+        template<typename F>
+        void block_line(int x1, int y1, int z1, int x2, int y2, int z2, F &&visit) const;
 
         virtual bool set_point(int x, int y, int z, bool solid, uint32_t color = 0);
         bool set_point(size_t pos, bool solid, uint32_t color);
+        // false if (x, y, z) isn't connected to the ground, its whole component gets destroyed if destroy is set
         bool check_node(int x, int y, int z, bool destroy, std::vector<VXLBlock> &destroyed);
+        // check_node for each of them, anything one search found on the ground ends the others early
+        void check_nodes(const glm::ivec3 *starts, int count, bool destroy, std::vector<VXLBlock> &destroyed);
 
         bool can_see(const glm::vec3 &position, const glm::vec3 &direction, long *x, long *y, long *z, float length = 32, bool isdirection=true) const;
-        Face hitscan(const glm::dvec3 &p, const glm::dvec3 &d, glm::ivec3 *h) const;
+        // accelerated skips through air using the height mips, the hit voxel and face are exactly the same either way
+        Face hitscan(const glm::dvec3 &p, const glm::dvec3 &d, glm::ivec3 *h, bool accelerated = true) const;
 
         bool clipworld(long x, long y, long z) const;
         bool clipbox(long x, long y, long z) const;
 
         void add_neighbors(std::vector<glm::ivec3> &v, const int x, const int y, const int z) const {
-            this->add_node(v, x, y, z - 1);
-            this->add_node(v, x, y - 1, z);
-            this->add_node(v, x, y + 1, z);
-            this->add_node(v, x - 1, y, z);
-            this->add_node(v, x + 1, y, z);
-            this->add_node(v, x, y, z + 1);
+            this->visit_neighbors(x, y, z, [&v](const glm::ivec3 &p) { v.push_back(p); });
+        }
+
+        // same into a fixed array, returns how many were written
+        int add_neighbors(glm::ivec3 (&out)[6], const int x, const int y, const int z) const {
+            int n = 0;
+            this->visit_neighbors(x, y, z, [&](const glm::ivec3 &p) { out[n++] = p; });
+            return n;
+        }
+
+        // calls visit(glm::ivec3) for every solid neighbour, same order as add_neighbors
+        template<typename F>
+        void visit_neighbors(const int x, const int y, const int z, F &&visit) const {
+            const glm::ivec3 offsets[6]{ { 0, 0, -1 }, { 0, -1, 0 }, { 0, 1, 0 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, 1 } };
+            for (const auto &o : offsets) {
+                if (this->get_solid(x + o.x, y + o.y, z + o.z))
+                    visit(glm::ivec3(x + o.x, y + o.y, z + o.z));
+            }
+        }
+
+        // bit z is set if (x, y, z) is solid, 0 outside the map like get_solid
+        uint64_t get_column(int x, int y, bool wrapped = false) const {
+            if (wrapped) {
+                x &= MAP_X - 1;
+                y &= MAP_Y - 1;
+            }
+            if (x < 0 || x >= int(MAP_X) || y < 0 || y >= int(MAP_Y)) return 0;
+            return this->geometry[x + y * MAP_X];
+        }
+
+        // get_vis for a whole column at once, bit z of faces[face] is set if that face of (x, y, z) is visible
+        void get_column_vis(const int x, const int y, uint64_t (&faces)[6], bool wrapped = false) const {
+            const uint64_t c = this->get_column(x, y, wrapped);
+            faces[int(Face::LEFT)] = c & ~this->get_column(x - 1, y, wrapped);
+            faces[int(Face::RIGHT)] = c & ~this->get_column(x + 1, y, wrapped);
+            faces[int(Face::BACK)] = c & ~this->get_column(x, y - 1, wrapped);
+            faces[int(Face::FRONT)] = c & ~this->get_column(x, y + 1, wrapped);
+            faces[int(Face::TOP)] = c & ~(c << 1);
+            faces[int(Face::BOTTOM)] = c & ~(c >> 1);
         }
 
         uint8_t get_vis(const int x, const int y, const int z, bool wrapped=false) const {
-            if (!this->get_solid(x, y, z, wrapped)) return 0;
+            if (z < 0 || z >= int(MAP_Z)) return 0;
+            const uint64_t c = this->get_column(x, y, wrapped);
+            if (!(c >> z & 1)) return 0;
 
+            const uint64_t above = z > 0 ? c >> (z - 1) & 1 : 0, below = c >> z >> 1 & 1;
             uint8_t vis = 0;
-            if (!this->get_solid(x - 1, y, z, wrapped)) vis |= 1 << int(Face::LEFT);
-            if (!this->get_solid(x + 1, y, z, wrapped)) vis |= 1 << int(Face::RIGHT);
-            if (!this->get_solid(x, y - 1, z, wrapped)) vis |= 1 << int(Face::BACK);
-            if (!this->get_solid(x, y + 1, z, wrapped)) vis |= 1 << int(Face::FRONT);
-            if (!this->get_solid(x, y, z - 1, wrapped)) vis |= 1 << int(Face::TOP);
-            if (!this->get_solid(x, y, z + 1, wrapped)) vis |= 1 << int(Face::BOTTOM);
+            if (!(this->get_column(x - 1, y, wrapped) >> z & 1)) vis |= 1 << int(Face::LEFT);
+            if (!(this->get_column(x + 1, y, wrapped) >> z & 1)) vis |= 1 << int(Face::RIGHT);
+            if (!(this->get_column(x, y - 1, wrapped) >> z & 1)) vis |= 1 << int(Face::BACK);
+            if (!(this->get_column(x, y + 1, wrapped) >> z & 1)) vis |= 1 << int(Face::FRONT);
+            if (!above) vis |= 1 << int(Face::TOP);
+            if (!below) vis |= 1 << int(Face::BOTTOM);
             return vis;
         }
 
@@ -115,16 +175,152 @@ namespace ace {
             return i;
         }
     protected:
-        void add_node(std::vector<glm::ivec3> &v, const int x, const int y, const int z) const {
-            if (this->get_solid(x, y, z))
-                v.emplace_back(x, y, z);
-        }
+        // size in bytes of the column starting at buf, or 0 if it doesn't fit in len bytes
+        static size_t column_size(const uint8_t *buf, size_t len = SIZE_MAX);
+        // colors have to be allocated already, read_column runs on several threads at once
+        void read_column(int x, int y, const uint8_t *buf);
 
     private:
-        std::bitset<MAP_X * MAP_Y * MAP_Z> geometry;
-        std::unordered_map<size_t, uint32_t> colors;
+        static constexpr int HEIGHT_LEVELS = 4;
+
+        // first solid z of a column, MAP_Z if there's none
+        static int column_top(uint64_t column) {
+            int z = 0;
+            while (z < int(MAP_Z) && !(column >> z & 1)) z++;
+            return z;
+        }
+
+        void gen_heights();
+        void update_height(int x, int y);
+
+        // pos from get_pos, which has to be valid
+        bool solid_at(const size_t pos) const {
+            return this->geometry[pos / MAP_Z] >> pos % MAP_Z & 1;
+        }
+
+        void set_solid(const size_t pos, const bool solid) {
+            const uint64_t bit = uint64_t(1) << pos % MAP_Z;
+            if (solid) this->geometry[pos / MAP_Z] |= bit;
+            else this->geometry[pos / MAP_Z] &= ~bit;
+        }
+
+        // one word per column (x + y * MAP_X), bit z is solid. same bit order as get_pos
+        std::vector<uint64_t> geometry;
+        // heights[0] is column_top of every column, level i is the lowest of those over 4^i x 4^i columns.
+        // everything above it is air, which lets hitscan skip whole boxes
+        std::vector<uint8_t> heights[HEIGHT_LEVELS];
+        // dense color store indexed by get_pos, 0 means no color has been assigned yet (see get_color).
+        // 64MB flat, which is still less than the hash map it replaced once a map was loaded.
+        // empty until something is written, so maps that are only made to be moved from don't pay for it
+        std::vector<uint32_t> colors;
+        void alloc_colors();
 
-        std::vector<glm::ivec3> nodes;
-        std::unordered_set<glm::ivec3> marked;
+        // visited and grounded bits for check_node, one word per column like geometry.
+        // the words only count if the generation matches, so nothing has to be cleared between searches
+        struct NodeColumn {
+            uint32_t search, pass;
+            uint64_t visited, grounded;
+        };
+
+        bool search_ground(const glm::ivec3 &start);
+        NodeColumn &node_column(int x, int y);
+
+        std::vector<NodeColumn> node_columns;
+        // search changes for every check_node, pass for every check_nodes
+        uint32_t node_search{ 0 }, node_pass{ 0 };
+        std::vector<glm::ivec3> nodes, marked;
+
+        friend struct VXLStreamReader;
+    };
+
+    template<typename F>
+    void AceMap::block_line(const int x1, const int y1, const int z1, const int x2, const int y2, const int z2, F &&visit) const {
+        glm::ivec3 c{ x1, y1, z1 };
+        glm::ivec3 d{ x2 - x1, y2 - y1, z2 - z1 };
+        long ixi, iyi, izi, dx, dy, dz, dxi, dyi, dzi;
+        const size_t VSID = MAP_X;
+
+        if (d.x < 0) ixi = -1;
+        else ixi = 1;
+        if (d.y < 0) iyi = -1;
+        else iyi = 1;
+        if (d.z < 0) izi = -1;
+        else izi = 1;
+
+        if ((abs(d.x) >= abs(d.y)) && (abs(d.x) >= abs(d.z)))
+        {
+            dxi = 1024; dx = 512;
+            dyi = static_cast<long>(!d.y ? 0x3fffffff / VSID : abs(d.x * 1024 / d.y));
+            dy = dyi / 2;
+            dzi = static_cast<long>(!d.z ? 0x3fffffff / VSID : abs(d.x * 1024 / d.z));
+            dz = dzi / 2;
+        }
+        else if (abs(d.y) >= abs(d.z))
+        {
+            dyi = 1024; dy = 512;
+            dxi = static_cast<long>(!d.x ? 0x3fffffff / VSID : abs(d.y * 1024 / d.x));
+            dx = dxi / 2;
+            dzi = static_cast<long>(!d.z ? 0x3fffffff / VSID : abs(d.y * 1024 / d.z));
+            dz = dzi / 2;
+        }
+        else
+        {
+            dzi = 1024; dz = 512;
+            dxi = static_cast<long>(!d.x ? 0x3fffffff / VSID : abs(d.z * 1024 / d.x));
+            dx = dxi / 2;
+            dyi = static_cast<long>(!d.y ? 0x3fffffff / VSID : abs(d.z * 1024 / d.y));
+            dy = dyi / 2;
+        }
+        if (ixi >= 0) dx = dxi - dx;
+        if (iyi >= 0) dy = dyi - dy;
+        if (izi >= 0) dz = dzi - dz;
+
+        while (true) {
+            visit(c);
+
+            if (c.x == x2 &&
+                c.y == y2 &&
+                c.z == z2)
+                break;
+
+            if ((dz <= dx) && (dz <= dy))
+            {
+                c.z += izi;
+                if (c.z < 0 || c.z >= MAP_Z)
+                    break;
+                dz += dzi;
+            }
+            else
+            {
+                if (dx < dy)
+                {
+                    c.x += ixi;
+                    if (static_cast<unsigned long>(c.x) >= VSID)
+                        break;
+                    dx += dxi;
+                }
+                else
+                {
+                    c.y += iyi;
+                    if (static_cast<unsigned long>(c.y) >= VSID)
+                        break;
+                    dy += dyi;
+                }
+            }
+        }
+    }
+
+    // Decodes a VXL byte stream into a new AceMap as it arrives, one whole column at a time.
+    // Bytes of a column that's only partially received are kept until the rest of it is fed in.
+    struct VXLStreamReader {
+        VXLStreamReader();
+
+        void feed(const uint8_t *data, size_t len);
+        bool done() const { return this->column == MAP_X * MAP_Y; }
+
+        std::unique_ptr<AceMap> map;
+    private:
+        std::vector<uint8_t> pending;
+        size_t column{ 0 };
     };
 }
\ No newline at end of file
@@ -120,6 +120,8 @@ namespace ace {
         KV6 mdl;
         std::unique_ptr<draw::VXLBlocks> ghost_block;
         glm::ivec3 m1, m2;
+        // reused every time the ghost line changes
+        std::vector<VXLBlock> line_blocks;
         bool last_secondary;
     };
 
@@ -31,6 +31,13 @@ namespace ace {
         void reposition(double dt);
     };
 
+    // one of the boxes bullets can hit, the matrices are worked out once a frame in transform()
+    struct Hitbox {
+        const KV6 *model;
+        net::HIT type;
+        glm::mat4 world, inverse;
+    };
+
     struct DrawPlayer : AcePlayer {
         explicit DrawPlayer(scene::GameScene& scene, bool local_player = false);
 
@@ -54,6 +61,9 @@ namespace ace {
 
         void play_sound(const std::string &name, int volume=100) const;
 
+        // if a ray could touch one of the hitboxes within max_distance, cheap test before trying the boxes
+        bool ray_near(const glm::vec3 &origin, const glm::vec3 &dir, float max_distance) const;
+
         
 
         uint8_t pid{}, health{};
@@ -65,6 +75,11 @@ namespace ace {
         std::string name;
 
         KV6 mdl_head, mdl_torso, mdl_legr, mdl_legl, mdl_arms, mdl_dead;
+        // head, torso and legs in the order they're checked, the first one hit counts
+        Hitbox hitboxes[4];
+        // voxel space sphere around all the hitboxes
+        glm::vec3 hit_center;
+        float hit_radius{ 0 };
         bool local_player{false};
 
         glm::vec3 draw_forward, draw_right;
@@ -81,5 +96,6 @@ namespace ace {
         double switch_time, next_footstep{};
     private:
         void transform();
+        void update_hitboxes();
     };
 }}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "vxl.h"
+#include "net/packet.h"
+
+namespace ace {
+    namespace scene {
+        class GameScene;
+    }
+
+    namespace world {
+    struct DrawPlayer;
+
+    struct RayHit {
+        // Face::INVALID if the ray left the map without hitting a block
+        Face face{ Face::INVALID };
+        glm::ivec3 block;
+        // nullptr if no player was hit before the block
+        DrawPlayer *player{ nullptr };
+        net::HIT type{ net::HIT::TORSO };
+        // where the player was hit, voxel space like sprhitscan
+        glm::vec3 player_hit;
+        // distances from the origin, FLT_MAX if there was nothing
+        float block_distance, player_distance;
+    };
+
+    // traces a volley of rays (shotgun pellets) from one point against the map and every player at once.
+    // uses the hitboxes DrawPlayer keeps for the frame and skips players whose bounding sphere the ray misses
+    class RayQuery {
+    public:
+        explicit RayQuery(scene::GameScene &scene) : scene(scene) { }
+
+        // hits[i] is for dirs[i], shooter is never hit
+        void trace(const glm::vec3 &origin, const std::vector<glm::vec3> &dirs, const DrawPlayer *shooter, std::vector<RayHit> &hits);
+
+    private:
+        scene::GameScene &scene;
+    };
+}}
@@ -1,7 +1,9 @@
 #version 330 core
-layout (location = 0) in vec3 pos;
-layout (location = 1) in vec3 vertex_color;
-layout (location = 2) in uint face;
+// see draw::detail::VXLVertex
+layout (location = 0) in uint packed_pos;
+layout (location = 1) in vec4 packed_color;
+// pillar position, per draw for the map and 0 for everything else
+layout (location = 2) in vec3 origin;
 
 out vec3 color;
 out float fog;
@@ -15,6 +17,8 @@ layout (std140) uniform SceneUniforms {
     vec3 cam_up;
     vec3 fog_color;
     vec3 light_pos;
+    float fog_start;
+    float fog_end;
 };
 
 uniform mat4 model;
@@ -31,9 +35,19 @@ const float shading[6] = float[](
     0.5
 );
 
+// sign extended bitfield, bitfieldExtract needs 4.0
+int extract(uint value, int offset, int bits) {
+    return int(value << uint(32 - offset - bits)) >> (32 - bits);
+}
+
 void main() {
+    vec3 pos = origin + vec3(extract(packed_pos, 0, 10), extract(packed_pos, 10, 8), extract(packed_pos, 18, 10));
+    uint face = packed_pos >> 28u;
+    vec3 vertex_color = packed_color.rgb;
+    float shade = packed_color.a * (255.0 / 127.0);
+
     vec4 view_space = view * model * vec4(pos, 1.0);
     gl_Position = proj * view_space;
-    color = (vertex_color == filter_color ? replacement_color : vertex_color) * shading[face];
-    fog = 1.0 - clamp((128 - length(view_space.xyz)) / 64, 0.0, 1.0);
+    color = (vertex_color == filter_color ? replacement_color : vertex_color) * shade * shading[face];
+    fog = 1.0 - clamp((fog_end - length(view_space.xyz)) / (fog_end - fog_start), 0.0, 1.0);
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "draw/map.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
 #include "game_client.h"
 #include "draw/sprite.h"
 #include "scene/game.h"
@@ -8,90 +12,22 @@ namespace ace { namespace draw {
     using namespace ace::draw::detail;
 
     namespace {
-        void gen_faces(const float x, const float y, const float z, const uint8_t vis, const glm::vec3 color, std::vector<VXLVertex> &v) {
-            const float x0 = x, x1 = x + 1.0f;
-            const float y0 = -z - 1.0f, y1 = -z;
-            const float z0 = y, z1 = y + 1.0f;
-
-            // vis = 0b11111111;
-
-            if (vis & 1 << int(Face::LEFT)) {
-                v.push_back({ { x0, y0, z0 }, color, 0 });
-                v.push_back({ { x0, y1, z0 }, color, 0 });
-                v.push_back({ { x0, y0, z1 }, color, 0 });
-                v.push_back({ { x0, y0, z1 }, color, 0 });
-                v.push_back({ { x0, y1, z0 }, color, 0 });
-                v.push_back({ { x0, y1, z1 }, color, 0 });
-            }
-            if (vis & 1 << int(Face::RIGHT)) {
-                v.push_back({ { x1, y0, z0 }, color, 1 });
-                v.push_back({ { x1, y0, z1 }, color, 1 });
-                v.push_back({ { x1, y1, z0 }, color, 1 });
-                v.push_back({ { x1, y1, z0 }, color, 1 });
-                v.push_back({ { x1, y0, z1 }, color, 1 });
-                v.push_back({ { x1, y1, z1 }, color, 1 });
-            }
-            if (vis & 1 << int(Face::BACK)) {
-                v.push_back({ { x0, y0, z0 }, color, 2 });
-                v.push_back({ { x1, y0, z0 }, color, 2 });
-                v.push_back({ { x0, y1, z0 }, color, 2 });
-                v.push_back({ { x0, y1, z0 }, color, 2 });
-                v.push_back({ { x1, y0, z0 }, color, 2 });
-                v.push_back({ { x1, y1, z0 }, color, 2 });
-            }
-            if (vis & 1 << int(Face::FRONT)) {
-                v.push_back({ { x0, y0, z1 }, color, 3 });
-                v.push_back({ { x0, y1, z1 }, color, 3 });
-                v.push_back({ { x1, y0, z1 }, color, 3 });
-                v.push_back({ { x1, y0, z1 }, color, 3 });
-                v.push_back({ { x0, y1, z1 }, color, 3 });
-                v.push_back({ { x1, y1, z1 }, color, 3 });
-            }
-            if (vis & 1 << int(Face::TOP)) {
-                v.push_back({ { x0, y1, z0 }, color, 4 });
-                v.push_back({ { x1, y1, z0 }, color, 4 });
-                v.push_back({ { x0, y1, z1 }, color, 4 });
-                v.push_back({ { x0, y1, z1 }, color, 4 });
-                v.push_back({ { x1, y1, z0 }, color, 4 });
-                v.push_back({ { x1, y1, z1 }, color, 4 });
-            }
-            if (vis & 1 << int(Face::BOTTOM)) {
-                v.push_back({ { x0, y0, z0 }, color, 5 });
-                v.push_back({ { x0, y0, z1 }, color, 5 });
-                v.push_back({ { x1, y0, z0 }, color, 5 });
-                v.push_back({ { x1, y0, z0 }, color, 5 });
-                v.push_back({ { x0, y0, z1 }, color, 5 });
-                v.push_back({ { x1, y0, z1 }, color, 5 });
-            }
+        // voxel color with sunblock and damage folded into the alpha channel, faces only merge if these match exactly
+        glm::u8vec4 shaded_color(DrawMap &map, const int x, const int y, const int z) {
+            uint8_t r, g, b, a;
+            unpack_bytes(map.get_color(x, y, z, true), &a, &r, &g, &b);
+            return { r, g, b, uint8_t(map.get_light(x, y, z) * a / 127) };
         }
     }
 
     VXLBlocks::VXLBlocks(const std::vector<VXLBlock> &blocks, const glm::vec3 &center) : scale(1), rotation(0), position(0) {
-        this->vao.attrib_pointer("3f,3f,1B", this->vbo.handle);
+        this->vao.attrib_pointer("1I,4Bn", this->vbo.handle);
         this->update(blocks, center);
     }
 
     void VXLBlocks::update(const std::vector<VXLBlock> &blocks, const glm::vec3 &center, bool gen_vis) {
         this->centroid = center;
-
-        std::unordered_set<glm::ivec3> bmap;
-        if(gen_vis) {
-            for (const VXLBlock &block : blocks) {
-                bmap.emplace(block.position.x, block.position.y, block.position.z);
-            }
-        }
-
-        for (const VXLBlock &block : blocks) {
-            uint8_t r, g, b, a;
-            unpack_bytes(block.color, &a, &r, &g, &b);
-
-            gen_faces(
-                block.position.x - this->centroid.x,
-                block.position.y - this->centroid.y,
-                block.position.z - this->centroid.z,
-                gen_vis ? VXLBlocks::get_vis(bmap, block.position) : block.vis, glm::vec3{ r, g, b } / 255.f, this->vbo.data
-            );
-        }
+        mesh_blocks(blocks, glm::ivec3(this->centroid), gen_vis, this->lookup, this->vbo.data);
         this->vbo.upload();
     }
 
@@ -100,48 +36,112 @@ namespace ace { namespace draw {
         this->vao.draw(GL_TRIANGLES, this->vbo.draw_count);
     }
 
-    uint8_t VXLBlocks::get_vis(std::unordered_set<glm::ivec3> &set, glm::ivec3 pos) {
-        if (!set.count(pos)) return 0;
-
-        uint8_t vis = 0;
-        if (!set.count({pos.x - 1, pos.y, pos.z})) vis |= 1 << int(Face::LEFT);
-        if (!set.count({pos.x + 1, pos.y, pos.z})) vis |= 1 << int(Face::RIGHT);
-        if (!set.count({pos.x, pos.y - 1, pos.z})) vis |= 1 << int(Face::BACK);
-        if (!set.count({pos.x, pos.y + 1, pos.z})) vis |= 1 << int(Face::FRONT);
-        if (!set.count({pos.x, pos.y, pos.z - 1})) vis |= 1 << int(Face::TOP);
-        if (!set.count({pos.x, pos.y, pos.z + 1})) vis |= 1 << int(Face::BOTTOM);
-        return vis;
+    void Pillar::upload(PillarMesh &mesh, gl::experimental::vbo<VXLVertex> &buffer) {
+        this->per_voxel = mesh.per_voxel;
+        this->quads = mesh.vertices.size() / 4;
+        size_t first = 0;
+        for (int i = 0; i < SUBCHUNKS; i++) {
+            SubChunk &c = this->chunks[i];
+            c.first = first;
+            c.count = mesh.chunk_quads[i];
+            c.min = mesh.chunk_min[i] + glm::vec3(this->x, 0, this->y);
+            c.max = mesh.chunk_max[i] + glm::vec3(this->x, 0, this->y);
+            c.occluded = false;
+            first += c.count;
+        }
+        std::swap(this->faces, mesh.faces);
+        this->slots.clear();
+        if (!mesh.vertices.empty()) {
+            buffer.update(this->offset * 4, mesh.vertices.data(), mesh.vertices.size());
+        }
     }
 
-    Pillar::Pillar(AceMap &map, size_t x, size_t y) : dirty(true), map(map), x(x), y(y) {
-        this->vao.attrib_pointer("3f,3f,1B", this->vbo.handle);
-    }
+    bool Pillar::patch(DrawMap &map, const std::vector<glm::ivec3> &voxels) {
+        if (this->slots.empty()) {
+            for (uint32_t i = 0; i < this->faces.size(); i++) {
+                this->slots[this->faces[i]] = i;
+            }
+        }
 
-    void Pillar::update() {
-        for (size_t ax = this->x; ax < this->x + PILLAR_SIZE; ax++) {
-            for (size_t ay = this->y; ay < this->y + PILLAR_SIZE; ay++) {
-                for (size_t az = 0; az < MAP_Z; az++) {
-                    uint8_t vis = map.get_vis(ax, ay, az, true);
-                    if (az == MAP_Z - 1) vis &= 1 << int(Face::TOP);
-                    if (vis == 0) continue;
+        std::vector<uint32_t> keys;
+        for (const auto &v : voxels) {
+            keys.push_back(face_key(v.x - int(this->x), v.y - int(this->y), v.z, 0));
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        std::vector<uint32_t> removed, added;
+        std::vector<VXLVertex> vertices;
+        for (const uint32_t key : keys) {
+            const int z = key / 8 % MAP_Z, ly = key / 8 / MAP_Z % PILLAR_SIZE, lx = key / 8 / MAP_Z / PILLAR_SIZE;
+            const int ax = int(this->x) + lx, ay = int(this->y) + ly;
+            for (int face = 0; face < 6; face++) {
+                auto it = this->slots.find(key + face);
+                if (it != this->slots.end()) removed.push_back(it->second);
+            }
 
-                    const uint32_t col = map.get_color(ax, ay, az);
-                    uint8_t r, g, b, a;
-                    unpack_bytes(col, &a, &r, &g, &b);
+            uint8_t vis = map.get_vis(ax, ay, z, true);
+            if (z == MAP_Z - 1) vis &= 1 << int(Face::TOP);
+            if (vis == 0) continue;
 
-                    gen_faces(ax, ay, az, vis, (glm::vec3{ r, g, b } * (map.sunblock(ax, ay, az) / 127.f) * (a / 127.f)) / 255.f, this->vbo.data);
-                }
+            const glm::u8vec4 color = shaded_color(map, ax, ay, z);
+            for (int face = 0; face < 6; face++) {
+                if (!(vis & 1 << face)) continue;
+                gen_quad(Face(face), lx, lx + 1, -z - 1, -z, ly, ly + 1, color, vertices);
+                added.push_back(key + face);
             }
         }
 
-        this->vbo.upload();
-        this->dirty = false;
-    }
+        if (this->faces.size() - removed.size() + added.size() > this->capacity) {
+            return false;
+        }
 
-    void Pillar::draw() {
-        if (dirty) this->update();
+        // highest slot first, so the last quad is never one that still has to be removed
+        std::sort(removed.begin(), removed.end(), std::greater<uint32_t>());
+        for (const uint32_t slot : removed) {
+            this->remove_quad(map.vertices, slot);
+        }
 
-        this->vao.draw(GL_TRIANGLES, this->vbo.draw_count);
+        if (!vertices.empty()) {
+            map.vertices.update((this->offset + this->faces.size()) * 4, vertices.data(), vertices.size());
+        }
+        for (const uint32_t key : added) {
+            this->slots[key] = uint32_t(this->faces.size());
+            this->faces.push_back(key);
+        }
+        this->quads = this->faces.size();
+
+        // quads moved between sub chunks, so fold them all into the first one and grow its bounds to cover the patch
+        glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+        for (auto &c : this->chunks) {
+            if (c.count == 0) continue;
+            lo = glm::min(lo, c.min);
+            hi = glm::max(hi, c.max);
+            c.count = 0;
+        }
+        for (const auto &v : voxels) {
+            lo = glm::min(lo, glm::vec3(v.x, -v.z - 1, v.y));
+            hi = glm::max(hi, glm::vec3(v.x + 1, -v.z, v.y + 1));
+        }
+
+        SubChunk &all = this->chunks[0];
+        all.first = 0;
+        all.count = this->quads;
+        all.min = lo;
+        all.max = hi;
+        all.occluded = false;
+        return true;
+    }
+
+    void Pillar::remove_quad(gl::experimental::vbo<VXLVertex> &buffer, uint32_t slot) {
+        const uint32_t last = uint32_t(this->faces.size() - 1);
+        this->slots.erase(this->faces[slot]);
+        if (slot != last) {
+            buffer.copy((this->offset + last) * 4, (this->offset + slot) * 4, 4);
+            this->faces[slot] = this->faces[last];
+            this->slots[this->faces[slot]] = slot;
+        }
+        this->faces.pop_back();
     }
 
     std::unique_ptr<uint8_t[]> read_file(const std::string &file_path) {
@@ -161,6 +161,22 @@ namespace ace { namespace draw {
     }
 
     DrawMap::DrawMap(scene::GameScene &s, uint8_t *buf) : AceMap(buf), scene(s) {
+        this->greedy_meshing = s.client.config.json["graphics"].value("greedy_meshing", true);
+        this->mesh_uploads_per_frame = s.client.config.json["graphics"].value("mesh_uploads_per_frame", 16);
+        this->occlusion_culling = s.client.config.json["graphics"].value("occlusion_culling", true);
+        this->lod_distance = s.client.config.json["graphics"].value("lod_distance", 64.0f);
+        this->deterministic = s.client.net.demo && s.client.net.demo->fast;
+        this->gen_light();
+        this->gen_pillars();
+    }
+
+    DrawMap::DrawMap(scene::GameScene &s, AceMap &&map) : AceMap(std::move(map)), scene(s) {
+        this->greedy_meshing = s.client.config.json["graphics"].value("greedy_meshing", true);
+        this->mesh_uploads_per_frame = s.client.config.json["graphics"].value("mesh_uploads_per_frame", 16);
+        this->occlusion_culling = s.client.config.json["graphics"].value("occlusion_culling", true);
+        this->lod_distance = s.client.config.json["graphics"].value("lod_distance", 64.0f);
+        this->deterministic = s.client.net.demo && s.client.net.demo->fast;
+        this->gen_light();
         this->gen_pillars();
     }
 
@@ -186,16 +202,329 @@ namespace ace { namespace draw {
         //
         // }
 
-        for (auto &p : this->pillars) {
+        {
+            util::ProfileZone zone(this->scene.client.profiler, "upload_pillars");
+            this->upload_pillars();
+        }
+        {
+            util::ProfileZone zone(this->scene.client.profiler, "patch_pillars");
+            this->patch_pillars();
+        }
+        this->occlusion_tests.clear();
+
+        for (size_t i = 0; i < this->pillars.size(); i++) {
+            Pillar &p = this->pillars[i];
             if (p.contains(draw2vox(this->scene.cam.position))) {
                 this->scene.debug.draw_cube({ p.x + 8, -32, p.y + 8 }, { PILLAR_SIZE, 64, PILLAR_SIZE }, { 1, 0, 0 });
             }
-            if (this->scene.cam.box_in_frustum(p.x, 0, p.y, p.x + PILLAR_SIZE, -64, p.y + PILLAR_SIZE)) {
-                p.draw();
+            if (!this->scene.cam.box_in_frustum(p.x, 0, p.y, p.x + PILLAR_SIZE, -64, p.y + PILLAR_SIZE)) continue;
+
+            // completely fogged out, would come out as the clear color anyway
+            const float distance = this->pillar_distance(p);
+            if (distance > this->scene.fog_distance) continue;
+
+            const int lod = this->pillar_lod(distance);
+            // the lod meshes missed some patches, rebuild instead of drawing them
+            if (lod != 0 && p.lod_dirty && !p.building) p.dirty = true;
+            // patched a while ago and left alone since, the greedy mesh is a lot smaller
+            if (p.edited && p.per_voxel && this->greedy_meshing && !p.building && this->scene.time - p.last_edit >= this->greedy_after_edit) p.dirty = true;
+            if (p.dirty && !p.building) this->build_pillar(i);
+
+            if (lod != 0 && !p.lod_dirty) {
+                this->queue_draw(p, p.lod_offset[lod - 1], 0, p.lod_quads[lod - 1]);
+                continue;
             }
+
+            // neighbouring visible chunks are contiguous, so they go out as one draw
+            size_t first = 0, count = 0;
+            for (auto &c : p.chunks) {
+                if (c.count == 0) continue;
+                if (this->scene.cam.box_in_frustum(c.min, c.max) && this->chunk_visible(c)) {
+                    if (count == 0) first = c.first;
+                    if (first + count == c.first) {
+                        count += c.count;
+                        continue;
+                    }
+                    this->queue_draw(p, p.offset, first, count);
+                    first = c.first;
+                    count = c.count;
+                }
+            }
+            this->queue_draw(p, p.offset, first, count);
+        }
+
+        this->submit_draws();
+        this->test_occlusion(shader);
+    }
+
+    // horizontal distance from the camera to the closest point of the pillar
+    float DrawMap::pillar_distance(const Pillar &p) const {
+        const glm::vec3 &eye = this->scene.cam.position;
+        const float dx = std::max({ p.x - eye.x, eye.x - (p.x + PILLAR_SIZE), 0.0f });
+        const float dz = std::max({ p.y - eye.z, eye.z - (p.y + PILLAR_SIZE), 0.0f });
+        return std::sqrt(dx * dx + dz * dz);
+    }
+
+    int DrawMap::pillar_lod(const float distance) const {
+        if (this->lod_distance <= 0) return 0;
+        if (distance >= this->lod_distance * 1.5f) return 2;
+        if (distance >= this->lod_distance) return 1;
+        return 0;
+    }
+
+    void DrawMap::queue_draw(const Pillar &p, size_t offset, size_t first, size_t count) {
+        if (count == 0) return;
+        // vertices are pillar local, the origin gets added in map.vert
+        const GLuint instance = GLuint(this->draw_origins->size());
+        this->draw_commands->push_back({ GLuint(count * 6), 1, GLuint(first * 6), GLint(offset * 4), instance });
+        this->draw_origins->push_back(glm::vec3(p.x, 0, p.y));
+    }
+
+    void DrawMap::submit_draws() {
+        if (this->draw_commands->empty()) return;
+
+        this->vao.bind();
+        if (this->multi_draw_indirect) {
+            this->draw_origins.upload();
+            this->draw_commands.upload();
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, this->draw_commands.draw_count, 0);
+            return;
+        }
+
+        // no base instance here, so the origin goes in the constant value of the (disabled) attribute instead
+        for (size_t i = 0; i < this->draw_commands->size(); i++) {
+            const DrawCommand &cmd = this->draw_commands.data[i];
+            const glm::vec3 &origin = this->draw_origins.data[i];
+            glVertexAttrib3f(2, origin.x, origin.y, origin.z);
+            glDrawElementsBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT, reinterpret_cast<void *>(cmd.first_index * sizeof(GLuint)), cmd.base_vertex);
         }
+        // everything else drawn with map.vert doesn't have an origin
+        glVertexAttrib3f(2, 0, 0, 0);
+        this->draw_commands->clear();
+        this->draw_origins->clear();
+    }
 
+    bool DrawMap::chunk_visible(SubChunk &chunk) {
+        if (!this->occlusion_culling) return true;
+
+        if (chunk.query_pending) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(chunk.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            // GL_QUERY_RESULT waits for it
+            if (available || this->deterministic) {
+                GLuint samples = 0;
+                glGetQueryObjectuiv(chunk.query, GL_QUERY_RESULT, &samples);
+                chunk.occluded = samples == 0;
+                chunk.query_pending = false;
+            }
+        }
 
+        // the box gets clipped by the near plane when the camera is inside it
+        const glm::vec3 &eye = this->scene.cam.position;
+        if (glm::all(glm::greaterThan(eye, chunk.min - 1.0f)) && glm::all(glm::lessThan(eye, chunk.max + 1.0f))) {
+            chunk.occluded = false;
+        } else if (!chunk.query_pending) {
+            this->occlusion_tests.push_back(&chunk);
+        }
+        return !chunk.occluded;
+    }
+
+    // draws the bounding box of every chunk that was in the frustum against the depth buffer of this frame,
+    // results get picked up by chunk_visible next frame (or whenever they're ready)
+    void DrawMap::test_occlusion(gl::ShaderProgram &shader) {
+        if (this->occlusion_tests.empty()) return;
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
+        for (SubChunk *c : this->occlusion_tests) {
+            // the bounds are tight, so the box faces would be in the same plane as the chunk's own faces (or be flat)
+            // and could lose the depth test against them. half a voxel out on every side keeps it in front
+            const glm::vec3 min = c->min - 0.5f, max = c->max + 0.5f;
+            shader.uniform("model", glm::scale(glm::translate(glm::mat4(1.0f), min), max - min));
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, c->query);
+            this->box_vao.draw(GL_TRIANGLES, this->box_vbo.draw_count);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            c->query_pending = true;
+        }
+        // everything else drawn with this shader expects the identity it had before
+        shader.uniform("model", glm::mat4(1.0f));
+        glEnable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    void DrawMap::build_pillar(size_t index) {
+        Pillar &p = this->pillars[index];
+        p.dirty = false;
+        p.building = true;
+        this->scene.client.frame_stats.count("pillar rebuilds");
+
+        auto snapshot = std::make_shared<PillarSnapshot>();
+        snapshot->index = index;
+        // nobody has touched it in a while, back to the greedy mesh
+        if (p.edited && this->scene.time - p.last_edit >= this->greedy_after_edit) p.edited = false;
+        snapshot->per_voxel = !this->greedy_meshing || p.edited;
+        snapshot->lods = this->lod_distance > 0;
+        // get_color can assign new colors, so it has to be called here and not on a worker
+        snapshot->copy(*this, this->light, int(p.x), int(p.y));
+
+        this->workers.push([this, snapshot] {
+            auto mesh = std::make_unique<PillarMesh>();
+            mesh_pillar(*snapshot, *mesh);
+
+            std::lock_guard<std::mutex> guard(this->finished_lock);
+            this->finished.push_back(std::move(mesh));
+        });
+    }
+
+    void DrawMap::upload_pillars() {
+        std::vector<std::unique_ptr<PillarMesh>> meshes;
+        if (this->deterministic) {
+            // everything queued last frame, in the order it was queued and not the order the workers got done
+            this->workers.wait();
+            std::lock_guard<std::mutex> guard(this->finished_lock);
+            std::stable_sort(this->finished.begin(), this->finished.end(), [](const std::unique_ptr<PillarMesh> &a, const std::unique_ptr<PillarMesh> &b) {
+                return a->index < b->index;
+            });
+        }
+        {
+            std::lock_guard<std::mutex> guard(this->finished_lock);
+            const size_t n = std::min(this->finished.size(), size_t(std::max(1, this->mesh_uploads_per_frame)));
+            for (size_t i = 0; i < n; i++) {
+                meshes.push_back(std::move(this->finished[i]));
+            }
+            this->finished.erase(this->finished.begin(), this->finished.begin() + n);
+        }
+
+        // room for patches to add faces without moving the pillar
+        const auto pillar_quads = [](const PillarMesh &mesh) {
+            const size_t quads = mesh.vertices.size() / 4;
+            return mesh.per_voxel ? quads + quads / 4 + 256 : quads;
+        };
+
+        if (this->allocator.size() == 0 && !meshes.empty()) {
+            // the first meshes of the map, guess how big all of it is from them. allocate_quads doubles it if that's short
+            size_t quads = 0;
+            for (auto &mesh : meshes) {
+                quads += pillar_quads(*mesh);
+                for (const auto &lod : mesh->lods) quads += lod.size() / 4;
+            }
+            quads = quads * this->pillars.size() / meshes.size();
+            this->vertices.reserve(quads * 4);
+            this->allocator.grow(quads);
+        }
+
+        for (auto &mesh : meshes) {
+            Pillar &p = this->pillars[mesh->index];
+            this->allocate_pillar(p, pillar_quads(*mesh));
+            p.upload(*mesh, this->vertices);
+            this->upload_lods(p, *mesh);
+            p.building = false;
+            this->reserve_quads(p.quads);
+        }
+    }
+
+    void DrawMap::upload_lods(Pillar &p, PillarMesh &mesh) {
+        for (int i = 0; i < LOD_LEVELS; i++) {
+            this->allocator.free(p.lod_offset[i], p.lod_quads[i]);
+            p.lod_quads[i] = mesh.lods[i].size() / 4;
+            p.lod_offset[i] = this->allocate_quads(p.lod_quads[i]);
+            if (p.lod_quads[i] != 0) {
+                this->vertices.update(p.lod_offset[i] * 4, mesh.lods[i].data(), mesh.lods[i].size());
+            }
+            this->reserve_quads(p.lod_quads[i]);
+        }
+        p.lod_dirty = false;
+    }
+
+    void DrawMap::allocate_pillar(Pillar &p, size_t quads) {
+        this->allocator.free(p.offset, p.capacity);
+        p.offset = this->allocate_quads(quads);
+        p.capacity = quads;
+    }
+
+    size_t DrawMap::allocate_quads(size_t quads) {
+        size_t offset = this->allocator.allocate(quads);
+        if (offset == util::RangeAllocator::npos) {
+            // reserve copies everything over, so nothing else has to move
+            const size_t size = this->allocator.size(), grown = std::max(size * 2, size + quads);
+            this->vertices.reserve(grown * 4);
+            this->allocator.grow(grown - size);
+            offset = this->allocator.allocate(quads);
+        }
+        return offset;
+    }
+
+    void DrawMap::patch_pillars() {
+        this->scene.client.frame_stats.count("pillar patches", int(this->patch_queue.size()));
+        for (const size_t i : this->patch_queue) {
+            Pillar &p = this->pillars[i];
+            p.edited = true;
+            p.last_edit = this->scene.time;
+            if (p.dirty || p.building) {
+                // whatever is being built now was copied before these edits
+                p.dirty = true;
+            } else if (!p.per_voxel) {
+                p.dirty = true;
+            } else if (p.patch(*this, p.pending)) {
+                p.lod_dirty = true;
+                this->reserve_quads(p.quads);
+            } else {
+                p.dirty = true;
+            }
+            p.pending.clear();
+        }
+        this->patch_queue.clear();
+    }
+
+    void DrawMap::queue_patch(const int x, const int y, const int z, const bool shape) {
+        const auto add = [this](int x, int y, int z) {
+            x &= MAP_X - 1;
+            y &= MAP_Y - 1;
+            Pillar &p = this->get_pillar(x, y);
+            if (p.pending.empty()) {
+                this->patch_queue.push_back(&p - this->pillars.data());
+            }
+            p.pending.emplace_back(x, y, z);
+        };
+
+        add(x, y, z);
+        if (!shape) return;
+
+        // only solid neighbours have a face towards this voxel
+        const glm::ivec3 neighbors[] = { { x - 1, y, z }, { x + 1, y, z }, { x, y - 1, z }, { x, y + 1, z }, { x, y, z - 1 }, { x, y, z + 1 } };
+        for (const auto &n : neighbors) {
+            if (this->get_solid(n.x, n.y, n.z, true)) add(n.x, n.y, n.z);
+        }
+        // the light of everything this can shadow changed, but it only shows on voxels with a visible face
+        for (int i = 1; i <= 9 && z + i < MAP_Z; i++) {
+            if (this->get_vis(x, y + i, z + i, true)) add(x, y + i, z + i);
+        }
+    }
+
+    // AceMap::sunblock for the whole map at once
+    void DrawMap::gen_light() {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        detail::gen_light(*this, this->light);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        fmt::print("LIGHT TIME: {}\n", std::chrono::duration<double>(end - start).count());
+    }
+
+    // quads are always 4 vertices with the same winding, so the indices are the same for every mesh.
+    void DrawMap::reserve_quads(size_t quads) {
+        const size_t current = size_t(this->quad_indices.draw_count) / 6;
+        if (quads <= current) return;
+
+        // uploading goes through the element buffer binding of whatever VAO is bound
+        this->vao.bind();
+        quads = std::max(quads, current * 2);
+        for (GLuint i = 0; i < quads * 4; i += 4) {
+            this->quad_indices.data.insert(this->quad_indices.data.end(), { i, i + 1, i + 2, i + 2, i + 1, i + 3 });
+        }
+        this->quad_indices.upload();
     }
 
     Pillar &DrawMap::get_pillar(const int x, const int y, const int z) {
@@ -209,42 +538,90 @@ namespace ace { namespace draw {
         pillars.reserve((MAP_X / PILLAR_SIZE) * (MAP_Y / PILLAR_SIZE));
         for (size_t x = 0; x < MAP_X / PILLAR_SIZE; x++) {
             for (size_t y = 0; y < MAP_Y / PILLAR_SIZE; y++) {
-                pillars.emplace_back(*this, x * PILLAR_SIZE, y * PILLAR_SIZE);
+                pillars.emplace_back(x * PILLAR_SIZE, y * PILLAR_SIZE);
             }
         }
+
+        this->multi_draw_indirect = GLAD_GL_VERSION_4_3;
+        this->vao.attrib_pointer("1I,4Bn", this->vertices.handle).element_buffer(this->quad_indices.handle);
+        if (this->multi_draw_indirect) {
+            this->vao.attrib_pointer("3f", this->draw_origins.handle, 1);
+        }
+        // the vertex buffer starts out empty, upload_pillars sizes it from the first meshes
+        this->allocator = util::RangeAllocator();
+        this->reserve_quads(PILLAR_SIZE * PILLAR_SIZE * 16);
+
+        // z = -1 puts the cube at y 0..1 in draw space
+        gen_faces(0, 0, -1, 0b111111, { 0, 0, 0, 0 }, this->box_vbo.data);
+        this->box_vbo.upload();
+        this->box_vao.attrib_pointer("1I,4Bn", this->box_vbo.handle);
+    }
+
+    void DrawMap::set_greedy_meshing(bool greedy) {
+        this->greedy_meshing = greedy;
+        for (auto &p : this->pillars) {
+            p.dirty = true;
+        }
     }
 
 
     bool DrawMap::set_point(const int x, const int y, const int z, const bool solid, const uint32_t color) {
-        bool ok = AceMap::set_point(x, y, z, solid, color);
+        const bool was_solid = this->get_solid(x, y, z);
+        if (!AceMap::set_point(x, y, z, solid, color)) return false;
+
+        this->edits.push_back({ { x, y, z }, was_solid });
+        // not in a batch, so it's a batch of one
+        if (this->edit_depth == 0) this->commit_edit();
+        return true;
+    }
 
-        this->get_pillar(x - 1, y, z).dirty |= ok;
-        this->get_pillar(x + 1, y, z).dirty |= ok;
-        this->get_pillar(x, y - 1, z).dirty |= ok;
-        this->get_pillar(x, y + 1, z).dirty |= ok;
-        // pillars dont render edges even across pillar boundries
-        // so you have to update adjacent pillars if the destroyed block shares a face with another pillar.
-        // TODO: shadows dont update across chunks. the origin block can be ~18 blocks a way, so maybe update all chunks within
-        // 18 blocks? or only in the direction of shadows (increasing y)
+    void DrawMap::commit_edit() {
+        if (this->edit_depth > 0 && --this->edit_depth > 0) return;
+        if (this->edits.empty()) return;
 
-        if (x == 0 || y == 0 || x == MAP_X - 1 || y == MAP_Y - 1 || !(x & 63) || !(y & 63)) {
-            return ok;
+        // a voxel edited more than once only gets done once, sorted by column so the minimap gets one write per column too
+        std::stable_sort(this->edits.begin(), this->edits.end(), [](const Edit &a, const Edit &b) { return ivec3_less(a.pos, b.pos); });
+        this->edits.erase(std::unique(this->edits.begin(), this->edits.end(), [](const Edit &a, const Edit &b) { return a.pos == b.pos; }), this->edits.end());
+
+        for (const Edit &e : this->edits) {
+            const int x = e.pos.x, y = e.pos.y, z = e.pos.z;
+            const bool solid = this->get_solid(x, y, z);
+
+            if (e.was_solid != solid) {
+                for (int i = 1; i <= 9 && z + i < MAP_Z; i++) {
+                    uint8_t &light = this->light[get_pos(x, (y + i) & (MAP_Y - 1), z + i)];
+                    light += solid ? -(20 - 2 * i) : 20 - 2 * i;
+                }
+            }
+
+            // pillars dont render edges even across pillar boundries
+            // so the neighbours (and the blocks this shadows) get patched too, even if they're in another pillar.
+            this->queue_patch(x, y, z, e.was_solid != solid);
         }
 
-        glm::u8vec4 pixel = unpack_argb(this->get_color(x, y, this->get_z(x, y)));
-        pixel.a = 255;
-        this->scene.hud.map_display.map->tex.set_pixel(x, y, pixel);
+        glm::ivec2 last(-1);
+        for (const Edit &e : this->edits) {
+            const int x = e.pos.x, y = e.pos.y;
+            if (last == glm::ivec2(x, y)) continue;
+            last = { x, y };
 
-        return ok;
+            if (x == 0 || y == 0 || x == MAP_X - 1 || y == MAP_Y - 1 || !(x & 63) || !(y & 63)) {
+                continue;
+            }
+
+            glm::u8vec4 pixel = unpack_argb(this->get_color(x, y, this->get_z(x, y)));
+            pixel.a = 255;
+            this->scene.hud.map_display.map->tex.set_pixel(x, y, pixel);
+        }
+        this->edits.clear();
     }
 
     bool DrawMap::build_point(const int x, const int y, const int z, glm::u8vec3 color, bool force) {
         if (!force) {
             if (!valid_build_pos(x, y, z)) return false;
 
-            std::vector<glm::ivec3> neighbors;
-            this->add_neighbors(neighbors, x, y, z);
-            if (neighbors.empty()) return false;
+            glm::ivec3 neighbors[6];
+            if (this->add_neighbors(neighbors, x, y, z) == 0) return false;
         }
 
         return this->set_point(x, y, z, true, pack_bytes(0x7F, color.r, color.g, color.b));
@@ -255,13 +632,13 @@ namespace ace { namespace draw {
 
         bool ok = this->set_point(x, y, z, false, 0);
 
-        std::vector<glm::ivec3> neighbors;
-        this->add_neighbors(neighbors, x, y, z);
-        for (const auto &node : neighbors) {
-            if (valid_build_pos(node.x, node.y, node.z)) {
-                this->check_node(node.x, node.y, node.z, true, destroyed);
-            }
-        }
+        glm::ivec3 neighbors[6];
+        int count = 0;
+        this->visit_neighbors(x, y, z, [&](const glm::ivec3 &node) {
+            if (valid_build_pos(node.x, node.y, node.z)) neighbors[count++] = node;
+        });
+        // one pass, so a neighbour that's attached to the ground through another one stops as soon as it gets there
+        this->check_nodes(neighbors, count, true, destroyed);
 
         return ok;
     }
@@ -301,6 +678,8 @@ namespace ace { namespace draw {
         }
         auto overview = this->scene.client.sprites.get("map_overview", SDL_CreateRGBSurfaceFrom(pixels.get(), MAP_X, MAP_Y, 24, 3 * MAP_X, 0xFF, 0xFF << 8, 0xFF << 16, 0));
         overview->set_antialias(false);
+        // set_point keeps drawing on this, so small uploads that don't stall
+        overview->tex.use_pbo = true;
         return overview;
     }
 }}
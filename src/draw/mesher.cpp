@@ -0,0 +1,397 @@
+#include "draw/mesher.h"
+
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <thread>
+
+#include "common.h"
+
+namespace ace { namespace draw { namespace detail {
+    namespace {
+        glm::u8vec4 shaded_color(const PillarSnapshot &snapshot, const int lx, const int ly, const int z) {
+            const size_t i = (lx * PILLAR_SIZE + ly) * MAP_Z + z;
+            uint8_t r, g, b, a;
+            unpack_bytes(snapshot.colors[i], &a, &r, &g, &b);
+            return { r, g, b, uint8_t(snapshot.light[i] * a / 127) };
+        }
+
+        // voxels are indexed (x, y, z) local to the pillar, z fastest like AceMap
+        void gen_vis(const PillarSnapshot &snapshot, std::vector<uint8_t> &vis, std::vector<glm::u8vec4> &colors) {
+            for (int lx = 0; lx < int(PILLAR_SIZE); lx++) {
+                for (int ly = 0; ly < int(PILLAR_SIZE); ly++) {
+                    uint64_t faces[6];
+                    snapshot.column_vis(lx, ly, faces);
+                    faces[int(Face::LEFT)] &= ~(uint64_t(1) << (MAP_Z - 1));
+                    faces[int(Face::RIGHT)] &= ~(uint64_t(1) << (MAP_Z - 1));
+                    faces[int(Face::BACK)] &= ~(uint64_t(1) << (MAP_Z - 1));
+                    faces[int(Face::FRONT)] &= ~(uint64_t(1) << (MAP_Z - 1));
+                    faces[int(Face::BOTTOM)] &= ~(uint64_t(1) << (MAP_Z - 1));
+
+                    for (int z = 0; z < MAP_Z; z++) {
+                        uint8_t v = 0;
+                        for (int face = 0; face < 6; face++) {
+                            v |= (faces[face] >> z & 1) << face;
+                        }
+                        const size_t i = (lx * PILLAR_SIZE + ly) * MAP_Z + z;
+                        vis[i] = v;
+                        if (v) colors[i] = shaded_color(snapshot, lx, ly, z);
+                    }
+                }
+            }
+        }
+
+        void gen_simple(const PillarSnapshot &snapshot, PillarMesh &mesh) {
+            thread_local std::vector<uint8_t> vis(PILLAR_SIZE * PILLAR_SIZE * MAP_Z);
+            thread_local std::vector<glm::u8vec4> colors(PILLAR_SIZE * PILLAR_SIZE * MAP_Z);
+            gen_vis(snapshot, vis, colors);
+
+            for (int lx = 0; lx < int(PILLAR_SIZE); lx++) {
+                for (int ly = 0; ly < int(PILLAR_SIZE); ly++) {
+                    for (int z = 0; z < MAP_Z; z++) {
+                        const size_t i = (lx * PILLAR_SIZE + ly) * MAP_Z + z;
+                        for (int face = 0; face < 6; face++) {
+                            if (!(vis[i] & 1 << face)) continue;
+                            gen_quad(Face(face), lx, lx + 1, -z - 1, -z, ly, ly + 1, colors[i], mesh.vertices);
+                            mesh.faces.push_back(face_key(lx, ly, z, face));
+                        }
+                    }
+                }
+            }
+        }
+
+        void gen_greedy(const PillarSnapshot &snapshot, PillarMesh &mesh) {
+            constexpr int dims[3] = { int(PILLAR_SIZE), int(PILLAR_SIZE), MAP_Z };
+            thread_local std::vector<uint8_t> vis(PILLAR_SIZE * PILLAR_SIZE * MAP_Z);
+            thread_local std::vector<glm::u8vec4> colors(PILLAR_SIZE * PILLAR_SIZE * MAP_Z);
+            // packed color + 1 << 32 for visible faces, 0 otherwise
+            thread_local std::vector<uint64_t> mask(PILLAR_SIZE * MAP_Z);
+            gen_vis(snapshot, vis, colors);
+
+            // sweep every slice perpendicular to each face direction, merging equally colored faces into rectangles
+            for (int face = 0; face < 6; face++) {
+                const uint8_t bit = 1 << face;
+                const int n = face / 2, u = (n + 1) % 3, w = (n + 2) % 3;
+                for (int slice = 0; slice < dims[n]; slice++) {
+                    int p[3];
+                    p[n] = slice;
+                    for (p[u] = 0; p[u] < dims[u]; p[u]++) {
+                        for (p[w] = 0; p[w] < dims[w]; p[w]++) {
+                            const size_t i = (p[0] * dims[1] + p[1]) * MAP_Z + p[2];
+                            const glm::u8vec4 c = colors[i];
+                            mask[p[u] * dims[w] + p[w]] = vis[i] & bit ? uint64_t(1) << 32 | pack_bytes(c.a, c.r, c.g, c.b) : 0;
+                        }
+                    }
+
+                    for (int i = 0; i < dims[u]; i++) {
+                        for (int j = 0; j < dims[w];) {
+                            const uint64_t color = mask[i * dims[w] + j];
+                            if (!color) {
+                                j++;
+                                continue;
+                            }
+
+                            int height = 1;
+                            while (j + height < dims[w] && mask[i * dims[w] + j + height] == color) height++;
+
+                            int width = 1;
+                            for (; i + width < dims[u]; width++) {
+                                const auto row = mask.begin() + (i + width) * dims[w] + j;
+                                if (std::any_of(row, row + height, [color](uint64_t c) { return c != color; })) break;
+                            }
+
+                            for (int k = 0; k < width; k++) {
+                                std::fill_n(mask.begin() + (i + k) * dims[w] + j, height, 0);
+                            }
+
+                            int lo[3], hi[3];
+                            lo[n] = slice; hi[n] = slice + 1;
+                            lo[u] = i; hi[u] = i + width;
+                            lo[w] = j; hi[w] = j + height;
+
+                            uint8_t r, g, b, a;
+                            unpack_bytes(uint32_t(color), &a, &r, &g, &b);
+                            gen_quad(Face(face), lo[0], hi[0], -hi[2], -lo[2], lo[1], hi[1], { r, g, b, a }, mesh.vertices);
+                            j += height;
+                        }
+                    }
+                }
+            }
+        }
+
+        // reorder the quads so every sub chunk is one contiguous range, and get tight bounds for each
+        void split_chunks(PillarMesh &mesh) {
+            const size_t quads = mesh.vertices.size() / 4;
+            std::vector<int> chunk(quads);
+            for (size_t q = 0; q < quads; q++) {
+                int z = MAP_Z;
+                for (size_t i = q * 4; i < q * 4 + 4; i++) {
+                    z = std::min(z, -vertex_position(mesh.vertices[i]).y);
+                }
+                chunk[q] = std::min(z / SUBCHUNK_Z, SUBCHUNKS - 1);
+            }
+
+            std::vector<VXLVertex> vertices;
+            std::vector<uint32_t> faces;
+            vertices.reserve(mesh.vertices.size());
+            faces.reserve(mesh.faces.size());
+            for (int c = 0; c < SUBCHUNKS; c++) {
+                glm::ivec3 lo(INT_MAX), hi(INT_MIN);
+                const size_t first = vertices.size() / 4;
+                for (size_t q = 0; q < quads; q++) {
+                    if (chunk[q] != c) continue;
+                    for (size_t i = q * 4; i < q * 4 + 4; i++) {
+                        const glm::ivec3 pos = vertex_position(mesh.vertices[i]);
+                        lo = glm::min(lo, pos);
+                        hi = glm::max(hi, pos);
+                        vertices.push_back(mesh.vertices[i]);
+                    }
+                    if (!mesh.faces.empty()) faces.push_back(mesh.faces[q]);
+                }
+                mesh.chunk_quads[c] = vertices.size() / 4 - first;
+                mesh.chunk_min[c] = glm::vec3(lo);
+                mesh.chunk_max[c] = glm::vec3(hi);
+            }
+            std::swap(mesh.vertices, vertices);
+            std::swap(mesh.faces, faces);
+        }
+
+        // heightfield of size x size column cells: the highest top in each cell with the average of the top colors,
+        // walls down to lower cells and skirts down to the water on the pillar edges to hide gaps to the neighbours
+        void gen_lod(const PillarSnapshot &snapshot, const int size, std::vector<VXLVertex> &v) {
+            const int cells = int(PILLAR_SIZE) / size;
+            std::vector<int> tops(cells * cells, int(MAP_Z));
+            std::vector<glm::u8vec4> colors(cells * cells);
+            for (int cx = 0; cx < cells; cx++) {
+                for (int cy = 0; cy < cells; cy++) {
+                    glm::uvec4 sum(0);
+                    unsigned n = 0;
+                    int &top = tops[cx * cells + cy];
+                    for (int lx = cx * size; lx < (cx + 1) * size; lx++) {
+                        for (int ly = cy * size; ly < (cy + 1) * size; ly++) {
+                            const uint64_t column = snapshot.column(lx, ly);
+                            if (column == 0) continue;
+                            int z = 0;
+                            while (!(column >> z & 1)) z++;
+                            top = std::min(top, z);
+                            sum += glm::uvec4(shaded_color(snapshot, lx, ly, z));
+                            n++;
+                        }
+                    }
+                    if (n != 0) colors[cx * cells + cy] = glm::u8vec4(sum / n);
+                }
+            }
+
+            const auto neighbour = [&](int cx, int cy) -> int {
+                if (cx < 0 || cy < 0 || cx >= cells || cy >= cells) return int(MAP_Z) - 1;
+                return tops[cx * cells + cy];
+            };
+
+            for (int cx = 0; cx < cells; cx++) {
+                for (int cy = 0; cy < cells; cy++) {
+                    const int top = tops[cx * cells + cy];
+                    if (top == int(MAP_Z)) continue;
+
+                    const glm::u8vec4 color = colors[cx * cells + cy];
+                    const int x0 = cx * size, x1 = x0 + size, z0 = cy * size, z1 = z0 + size;
+                    gen_quad(Face::TOP, x0, x1, -top - 1, -top, z0, z1, color, v);
+
+                    const std::pair<Face, int> sides[] = {
+                        { Face::LEFT, neighbour(cx - 1, cy) }, { Face::RIGHT, neighbour(cx + 1, cy) },
+                        { Face::BACK, neighbour(cx, cy - 1) }, { Face::FRONT, neighbour(cx, cy + 1) },
+                    };
+                    for (const auto &side : sides) {
+                        if (side.second > top) {
+                            gen_quad(side.first, x0, x1, -side.second, -top, z0, z1, color, v);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void gen_faces(const int x, const int y, const int z, const uint8_t vis, const glm::u8vec4 color, std::vector<VXLVertex> &v) {
+        const int x0 = x, x1 = x + 1;
+        const int y0 = -z - 1, y1 = -z;
+        const int z0 = y, z1 = y + 1;
+
+        // vis = 0b11111111;
+
+        if (vis & 1 << int(Face::LEFT)) {
+            v.push_back(make_vertex(x0, y0, z0, Face::LEFT, color));
+            v.push_back(make_vertex(x0, y1, z0, Face::LEFT, color));
+            v.push_back(make_vertex(x0, y0, z1, Face::LEFT, color));
+            v.push_back(make_vertex(x0, y0, z1, Face::LEFT, color));
+            v.push_back(make_vertex(x0, y1, z0, Face::LEFT, color));
+            v.push_back(make_vertex(x0, y1, z1, Face::LEFT, color));
+        }
+        if (vis & 1 << int(Face::RIGHT)) {
+            v.push_back(make_vertex(x1, y0, z0, Face::RIGHT, color));
+            v.push_back(make_vertex(x1, y0, z1, Face::RIGHT, color));
+            v.push_back(make_vertex(x1, y1, z0, Face::RIGHT, color));
+            v.push_back(make_vertex(x1, y1, z0, Face::RIGHT, color));
+            v.push_back(make_vertex(x1, y0, z1, Face::RIGHT, color));
+            v.push_back(make_vertex(x1, y1, z1, Face::RIGHT, color));
+        }
+        if (vis & 1 << int(Face::BACK)) {
+            v.push_back(make_vertex(x0, y0, z0, Face::BACK, color));
+            v.push_back(make_vertex(x1, y0, z0, Face::BACK, color));
+            v.push_back(make_vertex(x0, y1, z0, Face::BACK, color));
+            v.push_back(make_vertex(x0, y1, z0, Face::BACK, color));
+            v.push_back(make_vertex(x1, y0, z0, Face::BACK, color));
+            v.push_back(make_vertex(x1, y1, z0, Face::BACK, color));
+        }
+        if (vis & 1 << int(Face::FRONT)) {
+            v.push_back(make_vertex(x0, y0, z1, Face::FRONT, color));
+            v.push_back(make_vertex(x0, y1, z1, Face::FRONT, color));
+            v.push_back(make_vertex(x1, y0, z1, Face::FRONT, color));
+            v.push_back(make_vertex(x1, y0, z1, Face::FRONT, color));
+            v.push_back(make_vertex(x0, y1, z1, Face::FRONT, color));
+            v.push_back(make_vertex(x1, y1, z1, Face::FRONT, color));
+        }
+        if (vis & 1 << int(Face::TOP)) {
+            v.push_back(make_vertex(x0, y1, z0, Face::TOP, color));
+            v.push_back(make_vertex(x1, y1, z0, Face::TOP, color));
+            v.push_back(make_vertex(x0, y1, z1, Face::TOP, color));
+            v.push_back(make_vertex(x0, y1, z1, Face::TOP, color));
+            v.push_back(make_vertex(x1, y1, z0, Face::TOP, color));
+            v.push_back(make_vertex(x1, y1, z1, Face::TOP, color));
+        }
+        if (vis & 1 << int(Face::BOTTOM)) {
+            v.push_back(make_vertex(x0, y0, z0, Face::BOTTOM, color));
+            v.push_back(make_vertex(x0, y0, z1, Face::BOTTOM, color));
+            v.push_back(make_vertex(x1, y0, z0, Face::BOTTOM, color));
+            v.push_back(make_vertex(x1, y0, z0, Face::BOTTOM, color));
+            v.push_back(make_vertex(x0, y0, z1, Face::BOTTOM, color));
+            v.push_back(make_vertex(x1, y0, z1, Face::BOTTOM, color));
+        }
+    }
+
+    void gen_quad(const Face face, const int x0, const int x1, const int y0, const int y1, const int z0, const int z1, const glm::u8vec4 color, std::vector<VXLVertex> &v) {
+        switch (face) {
+        case Face::LEFT:
+            v.insert(v.end(), { make_vertex(x0, y0, z0, face, color), make_vertex(x0, y1, z0, face, color), make_vertex(x0, y0, z1, face, color), make_vertex(x0, y1, z1, face, color) });
+            break;
+        case Face::RIGHT:
+            v.insert(v.end(), { make_vertex(x1, y0, z0, face, color), make_vertex(x1, y0, z1, face, color), make_vertex(x1, y1, z0, face, color), make_vertex(x1, y1, z1, face, color) });
+            break;
+        case Face::BACK:
+            v.insert(v.end(), { make_vertex(x0, y0, z0, face, color), make_vertex(x1, y0, z0, face, color), make_vertex(x0, y1, z0, face, color), make_vertex(x1, y1, z0, face, color) });
+            break;
+        case Face::FRONT:
+            v.insert(v.end(), { make_vertex(x0, y0, z1, face, color), make_vertex(x0, y1, z1, face, color), make_vertex(x1, y0, z1, face, color), make_vertex(x1, y1, z1, face, color) });
+            break;
+        case Face::TOP:
+            v.insert(v.end(), { make_vertex(x0, y1, z0, face, color), make_vertex(x1, y1, z0, face, color), make_vertex(x0, y1, z1, face, color), make_vertex(x1, y1, z1, face, color) });
+            break;
+        case Face::BOTTOM:
+            v.insert(v.end(), { make_vertex(x0, y0, z0, face, color), make_vertex(x0, y0, z1, face, color), make_vertex(x1, y0, z0, face, color), make_vertex(x1, y0, z1, face, color) });
+            break;
+        default: return;
+        }
+    }
+
+    void PillarSnapshot::copy(AceMap &map, const std::vector<uint8_t> &light, const int x, const int y) {
+        for (int lx = SNAPSHOT_X0; lx < SNAPSHOT_X0 + SNAPSHOT_W; lx++) {
+            for (int ly = SNAPSHOT_Y0; ly < SNAPSHOT_Y0 + SNAPSHOT_L; ly++) {
+                this->column(lx, ly) = map.get_column(x + lx, y + ly, true);
+            }
+        }
+
+        for (int lx = 0; lx < int(PILLAR_SIZE); lx++) {
+            for (int ly = 0; ly < int(PILLAR_SIZE); ly++) {
+                uint64_t faces[6];
+                this->column_vis(lx, ly, faces);
+                const uint64_t visible = faces[0] | faces[1] | faces[2] | faces[3] | faces[4] | faces[5];
+                for (int z = 0; z < MAP_Z; z++) {
+                    if (visible >> z & 1) {
+                        const size_t i = (lx * PILLAR_SIZE + ly) * MAP_Z + z;
+                        this->colors[i] = map.get_color(x + lx, y + ly, z, true);
+                        this->light[i] = light[get_pos((x + lx) & (MAP_X - 1), (y + ly) & (MAP_Y - 1), z)];
+                    }
+                }
+            }
+        }
+    }
+
+    void mesh_pillar(const PillarSnapshot &snapshot, PillarMesh &mesh) {
+        mesh.index = snapshot.index;
+        mesh.per_voxel = snapshot.per_voxel;
+        if (snapshot.per_voxel) {
+            gen_simple(snapshot, mesh);
+        } else {
+            gen_greedy(snapshot, mesh);
+        }
+        split_chunks(mesh);
+        if (snapshot.lods) {
+            for (int i = 0; i < LOD_LEVELS; i++) {
+                gen_lod(snapshot, 2 << i, mesh.lods[i]);
+            }
+        }
+    }
+
+    void gen_light(const AceMap &map, std::vector<uint8_t> &light) {
+        light.assign(MAP_X * MAP_Y * MAP_Z, 127);
+
+        const unsigned threads = std::min<unsigned>(std::max(1u, std::thread::hardware_concurrency()), MAP_Y);
+        const int rows = (MAP_Y + threads - 1) / threads;
+        const auto parallel_rows = [&](const std::function<void(int y1, int y2)> &func) {
+            std::vector<std::thread> workers;
+            for (unsigned i = 1; i < threads; ++i) {
+                workers.emplace_back(func, std::min<int>(i * rows, MAP_Y), std::min<int>((i + 1) * rows, MAP_Y));
+            }
+            func(0, rows);
+            for (auto &worker : workers) {
+                worker.join();
+            }
+        };
+
+        // a voxel i blocks up and behind (y - i, z - i) takes 20 - 2i off, same as the loop in sunblock
+        parallel_rows([&map, &light](int y1, int y2) {
+            for (int y = y1; y < y2; y++) {
+                for (int x = 0; x < MAP_X; x++) {
+                    uint8_t *l = &light[get_pos(x, y, 0)];
+                    for (int i = 1; i <= 9; i++) {
+                        const uint64_t column = map.get_column(x, y - i, true);
+                        for (int z = i; z < MAP_Z; z++) {
+                            l[z] -= (column >> (z - i) & 1) * (20 - 2 * i);
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    uint8_t block_vis(const std::vector<glm::ivec3> &sorted, glm::ivec3 pos) {
+        const auto has = [&sorted](const glm::ivec3 &p) { return std::binary_search(sorted.begin(), sorted.end(), p, ivec3_less); };
+        if (!has(pos)) return 0;
+
+        uint8_t vis = 0;
+        if (!has({pos.x - 1, pos.y, pos.z})) vis |= 1 << int(Face::LEFT);
+        if (!has({pos.x + 1, pos.y, pos.z})) vis |= 1 << int(Face::RIGHT);
+        if (!has({pos.x, pos.y - 1, pos.z})) vis |= 1 << int(Face::BACK);
+        if (!has({pos.x, pos.y + 1, pos.z})) vis |= 1 << int(Face::FRONT);
+        if (!has({pos.x, pos.y, pos.z - 1})) vis |= 1 << int(Face::TOP);
+        if (!has({pos.x, pos.y, pos.z + 1})) vis |= 1 << int(Face::BOTTOM);
+        return vis;
+    }
+
+    void mesh_blocks(const std::vector<VXLBlock> &blocks, const glm::ivec3 origin, const bool gen_vis, std::vector<glm::ivec3> &lookup, std::vector<VXLVertex> &v) {
+        // sorted instead of a hash set so rebuilding the ghost line every time it changes doesn't allocate
+        lookup.clear();
+        if (gen_vis) {
+            for (const VXLBlock &block : blocks) {
+                lookup.push_back(block.position);
+            }
+            std::sort(lookup.begin(), lookup.end(), ivec3_less);
+        }
+
+        for (const VXLBlock &block : blocks) {
+            uint8_t r, g, b, a;
+            unpack_bytes(block.color, &a, &r, &g, &b);
+
+            const glm::ivec3 pos = block.position - origin;
+            gen_faces(pos.x, pos.y, pos.z, gen_vis ? block_vis(lookup, block.position) : block.vis, { r, g, b, 127 }, v);
+        }
+    }
+}}}
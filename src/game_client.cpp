@@ -8,6 +8,62 @@
 #include "scene/scene.h"
 
 namespace ace {
+    namespace {
+        const char *get_gl_debug_source_name(GLenum source) {
+            switch(source) {
+            case GL_DEBUG_SOURCE_API:
+                return "API";
+            case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+                return "WINDOW_SYSTEM";
+            case GL_DEBUG_SOURCE_SHADER_COMPILER:
+                return "SHADER_COMPILER";
+            case GL_DEBUG_SOURCE_THIRD_PARTY:
+                return "THIRD_PARTY";
+            case GL_DEBUG_SOURCE_APPLICATION:
+                return "APPLICATION";
+            case GL_DEBUG_SOURCE_OTHER:
+                return "OTHER";
+            default:
+                return "<UNKNOWN>";
+            }
+        
+        }
+
+        const char *get_gl_debug_type_name(GLenum type) {
+            switch (type) {
+            case GL_DEBUG_TYPE_ERROR:
+                return "ERROR";
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+                return "DEPRECATED_BEHAVIOR";
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+                return "UNDEFINED_BEHAVIOR";
+            case GL_DEBUG_TYPE_PORTABILITY:
+                return "PORTABILITY";
+            case GL_DEBUG_TYPE_PERFORMANCE:
+                return "PERFORMANCE";
+            case GL_DEBUG_TYPE_OTHER:
+                return "OTHER";
+            default:
+                return "<UNKNOWN>";
+            }
+        }
+
+        const char *get_gl_debug_severity_name(GLenum severity) {
+            switch (severity) {
+            case GL_DEBUG_SEVERITY_NOTIFICATION:
+                return "NOTIFICATION";
+            case GL_DEBUG_SEVERITY_LOW:
+                return "LOW";
+            case GL_DEBUG_SEVERITY_MEDIUM:
+                return "MEDIUM";
+            case GL_DEBUG_SEVERITY_HIGH:
+                return "HIGH";
+            default:
+                return "<UNKNOWN>";
+            }
+        }
+    }
+
     void APIENTRY gl_error(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *userParam) {
         if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) return;
 
@@ -54,6 +110,13 @@ namespace ace {
         return it->second;
     }
 
+    SDL_Scancode GameConfig::get_key(const std::string &key, SDL_Scancode fallback) {
+        // keys that were added after someone's config.json was written aren't in it
+        auto &controls(this->json["controls"]);
+        if (controls.find(key) == controls.end()) return fallback;
+        return this->get_key(key);
+    }
+
     // void GameConfig::read() {
     // }
     //
@@ -139,6 +202,15 @@ namespace ace {
     }
 
     GameClient::~GameClient() {
+        if (this->config.json["graphics"].value("frame_stats", true) && this->frame_stats.frames() != 0) {
+            fmt::print("FRAMES: {} p50: {:.2f} ms p95: {:.2f} ms p99: {:.2f} ms max: {:.2f} ms, {} spikes\n",
+                       this->frame_stats.frames(), this->frame_stats.percentile(0.5), this->frame_stats.percentile(0.95),
+                       this->frame_stats.percentile(0.99), this->frame_stats.max(), this->frame_stats.get_spikes().size());
+            if (!this->frame_stats.write_csv("frame_times.csv", "frame_spikes.csv")) {
+                fmt::print(stderr, "COULDN'T WRITE FRAME STATS\n");
+            }
+        }
+
         SDL_GL_DeleteContext(context);
         SDL_DestroyWindow(window);
         IMG_Quit();
@@ -150,6 +222,8 @@ namespace ace {
         while (!this->_quit) {
             Uint64 now = SDL_GetPerformanceCounter();
             double dt = (now - last) / double(SDL_GetPerformanceFrequency());
+            // fast demo playback steps the game the same amount every frame, so every run plays out the same
+            if (this->net.demo && this->net.demo->fast) dt = net::DemoPlayer::FAST_STEP;
             this->time += dt;
             last = now;
 
@@ -159,25 +233,53 @@ namespace ace {
 
 
     void GameClient::update(double dt) {
-        this->poll_events();
+        const Uint64 start = SDL_GetPerformanceCounter();
+        this->profiler.begin_frame();
+        {
+            util::ProfileZone zone(this->profiler, "poll_events");
+            this->poll_events();
+        }
         this->update_fps();
-        this->tasks.update(dt);
-        this->net.update(dt);
-        this->url.update(dt);
-        this->sound.update(dt);
-        this->scene->update(dt);
+        {
+            util::ProfileZone zone(this->profiler, "tasks");
+            this->tasks.update(dt);
+        }
+        {
+            util::ProfileZone zone(this->profiler, "net");
+            this->net.update(dt);
+        }
+        {
+            util::ProfileZone zone(this->profiler, "url");
+            this->url.update(dt);
+        }
+        {
+            util::ProfileZone zone(this->profiler, "sound");
+            this->sound.update(dt);
+        }
+        {
+            util::ProfileZone zone(this->profiler, "scene update");
+            this->scene->update(dt);
+        }
         this->draw();
+        this->profiler.end_frame();
+        this->frame_stats.end_frame((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
     }
 
-    void GameClient::draw() const {
-        this->scene->draw();
+    void GameClient::draw() {
+        {
+            util::ProfileZone zone(this->profiler, "draw", true);
+            this->scene->draw();
+        }
+        // blocks here when vsync is on or the gpu is behind
+        util::ProfileZone zone(this->profiler, "swap");
         SDL_GL_SwapWindow(this->window);
     }
 
     void GameClient::update_fps() {
         this->fps_counter.frames++;
         if (this->time - this->fps_counter.last_update >= 1) {
-            SDL_SetWindowTitle(this->window, fmt::format("{} (FPS: {})", this->window_title, this->fps_counter.frames).c_str());
+            // the average hides hitches, so the slowest 1% goes in there too
+            SDL_SetWindowTitle(this->window, fmt::format("{} (FPS: {}, p99: {:.1f} ms)", this->window_title, this->fps_counter.frames, this->frame_stats.percentile(0.99)).c_str());
             this->fps_counter.frames = 0;
             this->fps_counter.last_update = this->time;
         }
@@ -1,4 +1,8 @@
 #include "gl/gl_util.h"
+
+#include <climits>
+#include <cstring>
+
 #include "util/except.h"
 
 namespace ace { namespace gl {
@@ -84,7 +88,7 @@ namespace ace { namespace gl {
                 GLenum type = attrib.first;
                 size_t size = attrib.second;
                 bool normalized = false;
-                if(fmt.length() > 2u + offset && fmt.at(2 + offset) != 'n' && type != GL_FLOAT) {
+                if(fmt.length() > 2u + offset && fmt.at(2 + offset) == 'n' && type != GL_FLOAT) {
                     normalized = true;
                 }
 
@@ -158,8 +162,93 @@ namespace ace { namespace gl {
             this->width = width;
             this->height = height;
             this->_pixels = std::make_unique<pixel_type[]>(this->width * this->height);
+            this->allocated = false;
+            this->dirty_rects = 0;
 
             if (upload) this->full_upload();
         }
+
+        void texture2d::mark_dirty(const int x1, const int y1, const int x2, const int y2) {
+            const auto area = [](const glm::ivec4 &r) { return (r.z - r.x) * (r.w - r.y); };
+            const glm::ivec4 rect(x1, y1, x2, y2);
+
+            // join the rect that grows the least, unless that wastes more than a new rect would cost
+            int best = -1, best_growth = INT_MAX;
+            for (int i = 0; i < this->dirty_rects; i++) {
+                const glm::ivec4 &r = this->dirty_rect[i];
+                const glm::ivec4 joined(glm::min(glm::ivec2(r), glm::ivec2(rect)), glm::max(glm::ivec2(r.z, r.w), glm::ivec2(rect.z, rect.w)));
+                const int growth = area(joined) - area(r) - area(rect);
+                if (growth < best_growth) {
+                    best = i;
+                    best_growth = growth;
+                }
+            }
+
+            // roughly a couple rows of the minimap worth of pixels
+            if (best == -1 || (best_growth > 1024 && this->dirty_rects < MAX_DIRTY_RECTS)) {
+                this->dirty_rect[this->dirty_rects++] = rect;
+                return;
+            }
+
+            glm::ivec4 &r = this->dirty_rect[best];
+            r = glm::ivec4(glm::min(glm::ivec2(r), glm::ivec2(rect)), glm::max(glm::ivec2(r.z, r.w), glm::ivec2(rect.z, rect.w)));
+        }
+
+        void texture2d::upload() {
+            if (!this->allocated) {
+                this->full_upload();
+                return;
+            }
+            if (this->dirty_rects == 0) return;
+
+            this->bind(false);
+            if (!this->use_pbo) {
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, this->width);
+                for (int i = 0; i < this->dirty_rects; i++) {
+                    const glm::ivec4 &r = this->dirty_rect[i];
+                    glTexSubImage2D(texture2d::target, 0, r.x, r.y, r.z - r.x, r.w - r.y, texture2d::gl_format, GL_UNSIGNED_BYTE, &this->_pixels[r.y * this->width + r.x]);
+                }
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+                this->dirty_rects = 0;
+                return;
+            }
+
+            // every rect packed tightly one after the other, the driver copies from the buffer whenever it gets around to it
+            size_t size = 0;
+            for (int i = 0; i < this->dirty_rects; i++) {
+                const glm::ivec4 &r = this->dirty_rect[i];
+                size += size_t(r.z - r.x) * (r.w - r.y) * sizeof(pixel_type);
+            }
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            auto *buffer = static_cast<pixel_type *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+            if (buffer == nullptr) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                this->use_pbo = false;
+                this->upload();
+                return;
+            }
+
+            size_t offset = 0;
+            for (int i = 0; i < this->dirty_rects; i++) {
+                const glm::ivec4 &r = this->dirty_rect[i];
+                const int w = r.z - r.x;
+                for (int y = r.y; y < r.w; y++) {
+                    std::memcpy(buffer + offset, &this->_pixels[y * this->width + r.x], w * sizeof(pixel_type));
+                    offset += w;
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            offset = 0;
+            for (int i = 0; i < this->dirty_rects; i++) {
+                const glm::ivec4 &r = this->dirty_rect[i];
+                glTexSubImage2D(texture2d::target, 0, r.x, r.y, r.z - r.x, r.w - r.y, texture2d::gl_format, GL_UNSIGNED_BYTE, reinterpret_cast<void *>(offset * sizeof(pixel_type)));
+                offset += size_t(r.z - r.x) * (r.w - r.y);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            this->dirty_rects = 0;
+        }
     }
 }}
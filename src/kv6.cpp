@@ -1,9 +1,5 @@
 #include "kv6.h"
 
-#include <cstdio>
-#include <array>
-#include <cstddef>
-
 #include "glad/glad.h"
 #include "glm/glm.hpp"
 #include "fmt/format.h"
@@ -14,162 +10,13 @@
 
 using namespace detail;
 
-namespace {
-    // adapted from SLAB6.C by Ken Silverman (http://advsys.net/ken)
-    constexpr float GOLDRAT = 0.3819660112501052f;
-    constexpr float PI = 3.141592653589793f;
-    constexpr int TABLE_SIZE = 256;
-
-    glm::vec3 equiind2vec(long i, float zmulk, float zaddk) {
-        float z = i * zmulk + zaddk;
-        float r = sqrtf(1.f - z * z);
-        float v = i * (GOLDRAT * PI * 2);
-        float x = cos(v) * r;
-        float y = sin(v) * r;
-        return { -x, z, -y };
-    }
-
-    template<int N>
-    std::array<glm::vec3, N> equimemset() {
-        const float zmulk = 2.0f / N;
-        const float zaddk = zmulk * 0.5f - 1.0f;
-
-        std::array<glm::vec3, N> table{};
-
-//        table[table.size() - 1] = { 0, 0, 0 };
-        for (long i = N - 2; i >= 0; --i) {
-            table[i] = equiind2vec(i, zmulk, zaddk);
-        }
-        return table;
-    }
-
-    const auto NORMAL_TABLE = equimemset<TABLE_SIZE>();
-
-    struct KV6Vox {
-        uint8_t r, g, b, vis, normal;
-        uint16_t height;
-    };
-
-    void gen_faces(float x, float y, float z, glm::vec3 color, glm::vec3 kv6norm, uint8_t vis, std::vector<KV6Vertex> &v) {
-        const float x0 = x - 0.5f, x1 = x + 0.5f;
-        const float y0 = y - 0.5f, y1 = y + 0.5f;
-        const float z0 = z - 0.5f, z1 = z + 0.5f;
-
-        // vis = 0b11111111;
-
-
-        if (vis & 1 << 0) {
-            //LEFT
-            v.push_back({ { x0, y0, z0 }, color,{ -1, 0, 0 }, kv6norm/*, 0*/ });
-            v.push_back({ { x0, y1, z0 }, color,{ -1, 0, 0 }, kv6norm/*, 0*/ });
-            v.push_back({ { x0, y0, z1 }, color,{ -1, 0, 0 }, kv6norm/*, 0*/ });
-            v.push_back({ { x0, y0, z1 }, color,{ -1, 0, 0 }, kv6norm/*, 0*/ });
-            v.push_back({ { x0, y1, z0 }, color,{ -1, 0, 0 }, kv6norm/*, 0*/ });
-            v.push_back({ { x0, y1, z1 }, color,{ -1, 0, 0 }, kv6norm/*, 0*/ });
-        }
-        if (vis & 1 << 1) {
-            //RIGHT
-            v.push_back({ { x1, y0, z0 }, color,{ 1, 0, 0 }, kv6norm,/* 1 */});
-            v.push_back({ { x1, y0, z1 }, color,{ 1, 0, 0 }, kv6norm,/* 1 */});
-            v.push_back({ { x1, y1, z0 }, color,{ 1, 0, 0 }, kv6norm,/* 1 */});
-            v.push_back({ { x1, y1, z0 }, color,{ 1, 0, 0 }, kv6norm,/* 1 */});
-            v.push_back({ { x1, y0, z1 }, color,{ 1, 0, 0 }, kv6norm,/* 1 */});
-            v.push_back({ { x1, y1, z1 }, color,{ 1, 0, 0 }, kv6norm,/* 1 */});
-        }
-        if (vis & 1 << 2) {
-            //BACK
-            v.push_back({ { x0, y0, z0 }, color,{ 0, 0, -1 }, kv6norm/*, 2*/ });
-            v.push_back({ { x1, y0, z0 }, color,{ 0, 0, -1 }, kv6norm/*, 2*/ });
-            v.push_back({ { x0, y1, z0 }, color,{ 0, 0, -1 }, kv6norm/*, 2*/ });
-            v.push_back({ { x0, y1, z0 }, color,{ 0, 0, -1 }, kv6norm/*, 2*/ });
-            v.push_back({ { x1, y0, z0 }, color,{ 0, 0, -1 }, kv6norm/*, 2*/ });
-            v.push_back({ { x1, y1, z0 }, color,{ 0, 0, -1 }, kv6norm/*, 2*/ });
-        }
-        if (vis & 1 << 3) {
-            //FRONT
-            v.push_back({ { x0, y0, z1 }, color,{ 0, 0, 1 }, kv6norm,/* 3 */});
-            v.push_back({ { x0, y1, z1 }, color,{ 0, 0, 1 }, kv6norm,/* 3 */});
-            v.push_back({ { x1, y0, z1 }, color,{ 0, 0, 1 }, kv6norm,/* 3 */});
-            v.push_back({ { x1, y0, z1 }, color,{ 0, 0, 1 }, kv6norm,/* 3 */});
-            v.push_back({ { x0, y1, z1 }, color,{ 0, 0, 1 }, kv6norm,/* 3 */});
-            v.push_back({ { x1, y1, z1 }, color,{ 0, 0, 1 }, kv6norm,/* 3 */});
-        }
-        if (vis & 1 << 4) {
-            //TOP
-            v.push_back({ { x0, y1, z0 }, color,{ 0, 1, 0 }, kv6norm,/* 4 */});
-            v.push_back({ { x1, y1, z0 }, color,{ 0, 1, 0 }, kv6norm,/* 4 */});
-            v.push_back({ { x0, y1, z1 }, color,{ 0, 1, 0 }, kv6norm,/* 4 */});
-            v.push_back({ { x0, y1, z1 }, color,{ 0, 1, 0 }, kv6norm,/* 4 */});
-            v.push_back({ { x1, y1, z0 }, color,{ 0, 1, 0 }, kv6norm,/* 4 */});
-            v.push_back({ { x1, y1, z1 }, color,{ 0, 1, 0 }, kv6norm,/* 4 */});
-        }
-        if (vis & 1 << 5) {
-            //BOTTOM
-            v.push_back({ { x0, y0, z0 }, color,{ 0, -1, 0 }, kv6norm/*, 5*/ });
-            v.push_back({ { x0, y0, z1 }, color,{ 0, -1, 0 }, kv6norm/*, 5*/ });
-            v.push_back({ { x1, y0, z0 }, color,{ 0, -1, 0 }, kv6norm/*, 5*/ });
-            v.push_back({ { x1, y0, z0 }, color,{ 0, -1, 0 }, kv6norm/*, 5*/ });
-            v.push_back({ { x0, y0, z1 }, color,{ 0, -1, 0 }, kv6norm/*, 5*/ });
-            v.push_back({ { x1, y0, z1 }, color,{ 0, -1, 0 }, kv6norm/*, 5*/ });
-        }
-    }
-}
-
-
 KV6Mesh::KV6Mesh(const std::string &name) {
-    FILE *f = fopen(name.c_str(), "rb");
-    if (!f) THROW_ERROR("COULDN'T OPEN KV6Mesh FILE {}", name);
-
-    char magic[5];
-    fread(magic, 4, 1, f);
-    magic[4] = '\0';
-    if (strcmp(magic, "Kvxl") != 0) THROW_ERROR("INVALID KV6Mesh FILE MAGIC {}", name);
-
-    fread(&this->xsiz, sizeof(this->xsiz), 1, f); fread(&this->ysiz, sizeof(this->ysiz), 1, f); fread(&this->zsiz, sizeof(this->zsiz), 1, f);
-    fread(&this->xpiv, sizeof(this->xpiv), 1, f); fread(&this->ypiv, sizeof(this->ypiv), 1, f); fread(&this->zpiv, sizeof(this->zpiv), 1, f);
-    fread(&this->num_voxels, sizeof(this->num_voxels), 1, f);
-
-    
-
-//    KV6Vox *blocks = new KV6Vox[num_voxels];
-    std::unique_ptr<KV6Vox[]> blocks(std::make_unique<KV6Vox[]>(this->num_voxels));
-
-
-    for (long i = 0; i < this->num_voxels; i++) {
-        uint8_t b = fgetc(f);
-        uint8_t g = fgetc(f);
-        uint8_t r = fgetc(f);
-        uint8_t a = fgetc(f);
-        uint16_t height;
-        fread(&height, sizeof(height), 1, f);
-        uint8_t visibility = fgetc(f);
-        uint8_t normalindex = fgetc(f);
-        blocks[i] = { r, g, b, visibility, normalindex, height };
-    }
-    fseek(f, xsiz * 4, SEEK_CUR);
-
-//    uint16_t *xyoffset = new uint16_t[xsiz * ysiz];
-    std::unique_ptr<uint16_t[]> xyoffset(std::make_unique<uint16_t[]>(xsiz * ysiz));
-//    fread(&xyoffset, sizeof(uint16_t), xsiz * ysiz, f);
-    for (int i = 0; i < xsiz * ysiz; ++i) {
-        fread(&xyoffset[i], sizeof(decltype(xyoffset)::element_type), 1, f);
-    }
-    fclose(f);
-    
-    this->vbo->reserve(24 * this->num_voxels);
-
-    int p = 0;
-    for(long x = 0; x < this->xsiz; x++) {
-        for(long y = 0; y < this->ysiz; y++) {
-            uint16_t siz = xyoffset[x * this->ysiz + y];
-            for (uint16_t i = 0; i < siz; i++) {
-                KV6Vox &b = blocks[p];
-                gen_faces(x - this->xpiv, -b.height + this->zpiv, y - this->ypiv, glm::vec3{ b.r, b.g, b.b } / 255.f, NORMAL_TABLE[b.normal], b.vis, this->vbo.data);
-                p++;
-            }
-        }
-    }
+    const KV6Data data(name);
+    this->xsiz = data.xsiz; this->ysiz = data.ysiz; this->zsiz = data.zsiz;
+    this->xpiv = data.xpiv; this->ypiv = data.ypiv; this->zpiv = data.zpiv;
+    this->num_voxels = data.num_voxels;
 
+    data.gen_vertices(this->vbo.data);
     this->vao.attrib_pointer("3f,3f,3f,3f", this->vbo.handle);
     this->vbo.upload();
 }
@@ -179,15 +26,17 @@ KV6Mesh::KV6Mesh(const std::string &name) {
 // *h -> set to the (world) position of the hit (unchanged if not hit)
 // Adapted from https://gamedev.stackexchange.com/questions/18436/most-efficient-aabb-vs-ray-collision-algorithms/18459#18459
 bool KV6::sprhitscan(glm::vec3 ray_origin, glm::vec3 ray_direction, glm::vec3 *h) {
+    const glm::mat4 mm = this->get_model();
+    return this->sprhitscan(ray_origin, ray_direction, h, mm, glm::inverse(mm));
+}
+
+bool KV6::sprhitscan(glm::vec3 ray_origin, glm::vec3 ray_direction, glm::vec3 *h, const glm::mat4 &mm, const glm::mat4 &inverse) const {
     auto piv = glm::vec3{ this->mesh->xpiv, this->mesh->ypiv, this->mesh->zpiv };
     auto siz = glm::vec3{ this->mesh->xsiz, this->mesh->ysiz, this->mesh->zsiz };
 
     glm::vec3 min = ace::vox2draw(-piv);
     glm::vec3 max = ace::vox2draw(siz - piv);
 
-    glm::mat4 mm = this->get_model();
-    glm::mat4 inverse = glm::inverse(mm);
-
     glm::vec3 r_origin = inverse * glm::vec4(ace::vox2draw(ray_origin), 1.0);
     glm::vec3 r_direction = glm::normalize(inverse * glm::vec4(ace::vox2draw(ray_direction), 0.0));
 
@@ -12,7 +12,23 @@ int main(int argc, char **argv) {
 #endif
         ace::GameClient client("ACE: \"Ace of Spades\" CliEnt");
         std::string ip(argc > 1 ? argv[1] : "aos://180274501:32887:0.75");
-        client.set_scene<ace::scene::MainMenuScene>();
+
+        // -record demo.dem records the next game, -play demo.dem watches one again, -fast plays it as fast as possible
+        std::string play;
+        bool fast = false;
+        for (int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            if (arg == "-record" && i + 1 < argc) client.net.record_demo(argv[++i]);
+            else if (arg == "-play" && i + 1 < argc) play = argv[++i];
+            else if (arg == "-fast") fast = true;
+        }
+
+        if (!play.empty()) {
+            client.net.play_demo(play, fast);
+            client.set_scene<ace::scene::LoadingScene>(ace::net::Server(play, 0, "0.75"));
+        } else {
+            client.set_scene<ace::scene::MainMenuScene>();
+        }
         client.run();
         return 0;
 #ifdef NDEBUG
@@ -0,0 +1,125 @@
+#include "net/demo.h"
+
+#include <cstring>
+#include <random>
+
+#include "zlib.h"
+
+#include "util/except.h"
+
+namespace ace { namespace net {
+    namespace {
+        const char DEMO_MAGIC[] = "ACEDEMO";
+
+        void write_varint(std::vector<uint8_t> &out, uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(uint8_t(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(uint8_t(value));
+        }
+
+        bool read_varint(const std::vector<uint8_t> &in, size_t &pos, uint64_t &value) {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (pos >= in.size()) return false;
+                const uint8_t b = in[pos++];
+                value |= uint64_t(b & 0x7F) << shift;
+                if (!(b & 0x80)) return true;
+            }
+            return false;
+        }
+    }
+
+    constexpr double DemoPlayer::FAST_STEP;
+
+    DemoRecorder::DemoRecorder(const std::string &file_path) : seed(std::random_device{}()), file(gzopen(file_path.c_str(), "wb")), last(std::chrono::steady_clock::now()) {
+        if (this->file == nullptr) {
+            THROW_ERROR("COULDN'T OPEN DEMO {} FOR WRITING", file_path);
+        }
+        gzwrite(this->file, DEMO_MAGIC, sizeof(DEMO_MAGIC) - 1);
+        gzputc(this->file, DEMO_VERSION);
+        for (int i = 0; i < 4; i++) gzputc(this->file, this->seed >> i * 8 & 0xFF);
+        fmt::print("RECORDING DEMO TO {}\n", file_path);
+    }
+
+    DemoRecorder::~DemoRecorder() {
+        gzclose(this->file);
+        fmt::print("DEMO RECORDED, {} PACKETS\n", this->packets);
+    }
+
+    void DemoRecorder::record(const uint8_t *data, size_t len) {
+        const auto now = std::chrono::steady_clock::now();
+        this->scratch.clear();
+        write_varint(this->scratch, std::chrono::duration_cast<std::chrono::microseconds>(now - this->last).count());
+        write_varint(this->scratch, len);
+        this->last = now;
+
+        gzwrite(this->file, this->scratch.data(), unsigned(this->scratch.size()));
+        gzwrite(this->file, data, unsigned(len));
+        this->packets++;
+    }
+
+    DemoPlayer::DemoPlayer(const std::string &file_path, bool fast) : fast(fast) {
+        gzFile file = gzopen(file_path.c_str(), "rb");
+        if (file == nullptr) {
+            THROW_ERROR("COULDN'T OPEN DEMO {}", file_path);
+        }
+
+        uint8_t chunk[1 << 16];
+        int n;
+        while ((n = gzread(file, chunk, sizeof(chunk))) > 0) {
+            this->buf.insert(this->buf.end(), chunk, chunk + n);
+        }
+        gzclose(file);
+
+        const size_t header = sizeof(DEMO_MAGIC) - 1;
+        if (this->buf.size() <= header || memcmp(this->buf.data(), DEMO_MAGIC, header) != 0) {
+            THROW_ERROR("{} IS NOT A DEMO", file_path);
+        }
+        if (this->buf[header] != DEMO_VERSION) {
+            THROW_ERROR("DEMO {} IS VERSION {}, ONLY {} IS SUPPORTED", file_path, this->buf[header], DEMO_VERSION);
+        }
+        if (this->buf.size() < header + 5) {
+            THROW_ERROR("DEMO {} IS TRUNCATED", file_path);
+        }
+        for (int i = 0; i < 4; i++) this->seed |= uint32_t(this->buf[header + 1 + i]) << i * 8;
+
+        size_t pos = header + 5;
+        double time = 0;
+        uint64_t us, len;
+        while (pos < this->buf.size()) {
+            // a game that crashed mid write leaves a cut off record at the end, everything before it is still fine
+            if (!read_varint(this->buf, pos, us) || !read_varint(this->buf, pos, len) || len > this->buf.size() - pos) {
+                fmt::print(stderr, "DEMO {} IS TRUNCATED AFTER {} PACKETS\n", file_path, this->packets.size());
+                break;
+            }
+            time += us / 1e6;
+            this->packets.push_back({ time, pos, size_t(len) });
+            pos += len;
+        }
+
+        fmt::print("DEMO {}: {} PACKETS, {:.1f} s\n", file_path, this->packets.size(), this->duration());
+    }
+
+    void DemoPlayer::start() {
+        this->time = 0;
+        this->frames = 0;
+        this->next = 0;
+        this->started = std::chrono::steady_clock::now();
+    }
+
+    void DemoPlayer::advance(double dt) {
+        this->time += this->fast ? FAST_STEP : dt;
+        this->frames++;
+    }
+
+    const DemoPlayer::Packet *DemoPlayer::poll() {
+        if (this->done() || this->packets[this->next].time > this->time) return nullptr;
+        return &this->packets[this->next++];
+    }
+
+    double DemoPlayer::wall_time() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->started).count();
+    }
+}}
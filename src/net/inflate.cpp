@@ -0,0 +1,87 @@
+#include "net/inflate.h"
+
+#include "zlib.h"
+
+#include "util/except.h"
+
+namespace ace { namespace net {
+    std::vector<uint8_t> inflate(uint8_t *data, size_t len, size_t initial_size) {
+        z_stream stream;
+
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+
+        std::vector<uint8_t> buf(initial_size);
+
+        stream.next_in = data;
+        stream.avail_in = len;
+        stream.next_out = buf.data();
+        stream.avail_out = buf.size();
+        
+        int status = inflateInit(&stream);
+        do {
+            if (status != Z_OK && status != Z_BUF_ERROR) {
+                inflateEnd(&stream);
+                THROW_ERROR("ERROR INFLATING DATA (size {}): {}", len, zError(status));
+            }
+
+            status = inflate(&stream, Z_FINISH);
+
+            size_t position = stream.next_out - buf.data();
+            if (position >= buf.size()) {
+                buf.resize(position * 2);
+            }
+            stream.avail_out = buf.size() - position;
+            stream.next_out = buf.data() + position;
+        } while (status != Z_STREAM_END);
+        inflateEnd(&stream);
+
+        return buf;
+    }
+
+    StreamInflater::StreamInflater() : stream(std::make_unique<z_stream>()) {
+        this->stream->zalloc = Z_NULL;
+        this->stream->zfree = Z_NULL;
+        this->stream->opaque = Z_NULL;
+        this->stream->next_in = Z_NULL;
+        this->stream->avail_in = 0;
+
+        int status = inflateInit(this->stream.get());
+        if (status != Z_OK) {
+            THROW_ERROR("ERROR INITIALIZING INFLATE STREAM: {}", zError(status));
+        }
+    }
+
+    StreamInflater::~StreamInflater() {
+        inflateEnd(this->stream.get());
+    }
+
+    const std::vector<uint8_t> &StreamInflater::feed(const uint8_t *data, size_t len) {
+        this->output.clear();
+        if (this->finished) return this->output;
+
+        this->stream->next_in = const_cast<uint8_t *>(data);
+        this->stream->avail_in = len;
+
+        do {
+            size_t position = this->output.size();
+            this->output.resize(position + (2 << 16));
+            this->stream->next_out = this->output.data() + position;
+            this->stream->avail_out = this->output.size() - position;
+
+            int status = ::inflate(this->stream.get(), Z_NO_FLUSH);
+            this->output.resize(this->stream->next_out - this->output.data());
+
+            if (status == Z_STREAM_END) {
+                this->finished = true;
+                break;
+            }
+            if (status != Z_OK && status != Z_BUF_ERROR) {
+                THROW_ERROR("ERROR INFLATING DATA (size {}): {}", len, zError(status));
+            }
+        } while (this->stream->avail_in > 0 || this->stream->avail_out == 0);
+
+        return this->output;
+    }
+}}
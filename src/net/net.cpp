@@ -1,6 +1,7 @@
 #include "net/net.h"
 
-#include "zlib.h"
+#include <algorithm>
+#include <cstdlib>
 
 #include "game_client.h"
 #include "scene/game.h"
@@ -8,43 +9,16 @@
 #include "scene/menu.h"
 
 namespace ace { namespace net {
-    std::vector<uint8_t> inflate(uint8_t *data, size_t len, size_t initial_size) {
-        z_stream stream;
-
-        stream.zalloc = Z_NULL;
-        stream.zfree = Z_NULL;
-        stream.opaque = Z_NULL;
-
-        std::vector<uint8_t> buf(initial_size);
-
-        stream.next_in = data;
-        stream.avail_in = len;
-        stream.next_out = buf.data();
-        stream.avail_out = buf.size();
-        
-        int status = inflateInit(&stream);
-        do {
-            if (status != Z_OK && status != Z_BUF_ERROR) {
-                inflateEnd(&stream);
-                THROW_ERROR("ERROR INFLATING DATA (size {}): {}", len, zError(status));
-            }
-
-            status = inflate(&stream, Z_FINISH);
-
-            size_t position = stream.next_out - buf.data();
-            if (position >= buf.size()) {
-                buf.resize(position * 2);
-            }
-            stream.avail_out = buf.size() - position;
-            stream.next_out = buf.data() + position;
-        } while (status != Z_STREAM_END);
-        inflateEnd(&stream);
+    constexpr int VERSION = 3;
 
-        return buf;
+    namespace {
+        // rand() picks dirt colors and the engine does spread, particles...
+        void seed_game(uint32_t seed) {
+            srand(seed);
+            random::engine().seed(seed);
+        }
     }
 
-    constexpr int VERSION = 3;
-
     // lmao awful design, or GENIUS?
     BaseNetClient::enet_initer BaseNetClient::initer;
 
@@ -130,18 +104,82 @@ namespace ace { namespace net {
     }
 
     void NetworkClient::connect(const Server &server) {
+        if (this->demo) {
+            // no handshake to wait for, the demo starts with whatever the server sent first
+            this->demo->start();
+            seed_game(this->demo->seed);
+            this->set_state(NetState::CONNECTED);
+            return;
+        }
+
         if(server.version != "0.75")
             THROW_ERROR("Ace of Spades {} unsupported!\n", server.version);
         
         BaseNetClient::connect(server.ip.c_str(), server.port, VERSION);
+        if (!this->demo_path.empty()) {
+            this->recorder = std::make_unique<DemoRecorder>(this->demo_path);
+            seed_game(this->recorder->seed);
+        }
         this->set_state(NetState::CONNECTING);
     }
 
+    void NetworkClient::update(double dt) {
+        if (!this->demo) {
+            BaseNetClient::update(dt);
+            return;
+        }
+
+        if (this->state != NetState::CONNECTED && this->state != NetState::MAP_TRANSFER) return;
+
+        this->demo->advance(dt);
+        // on_receive only looks at the packet data, so a fake event is enough
+        ENetPacket packet{};
+        ENetEvent event{};
+        event.type = ENET_EVENT_TYPE_RECEIVE;
+        event.packet = &packet;
+        while (this->demo) {
+            const DemoPlayer::Packet *p = this->demo->poll();
+            if (p == nullptr) break;
+            packet.data = this->demo->data(*p);
+            packet.dataLength = p->len;
+            this->on_receive(event);
+        }
+
+        if (this->demo && this->demo->done()) this->end_demo();
+    }
+
+    void NetworkClient::disconnect() {
+        BaseNetClient::disconnect();
+        this->recorder.reset();
+        this->demo.reset();
+    }
+
+    void NetworkClient::play_demo(const std::string &file_path, bool fast) {
+        this->demo = std::make_unique<DemoPlayer>(file_path, fast);
+    }
+
+    void NetworkClient::end_demo() {
+        const double wall = this->demo->wall_time();
+        fmt::print("DEMO DONE: {} frames in {:.2f} s ({:.1f} fps), {:.1f} s of game\n",
+                   this->demo->frames, wall, this->demo->frames / std::max(wall, 1e-6), this->demo->time);
+        const bool fast = this->demo->fast;
+        this->demo.reset();
+
+        if (fast) {
+            // a benchmark run, the frame stats get written on the way out
+            this->client.quit();
+        } else {
+            this->set_state(NetState::DISCONNECTED);
+            this->client.set_scene<ace::scene::MainMenuScene>();
+        }
+    }
+
     void NetworkClient::on_connect(const ENetEvent &event) {
         this->set_state(NetState::CONNECTED);
     }
 
     void NetworkClient::on_disconnect(const ENetEvent &event) {
+        this->recorder.reset();
         this->disconnect_reason = DISCONNECT(event.data);
         this->set_state(NetState::DISCONNECTED);
         fmt::print("DISCONNECTED: {}\n", get_disconnect_reason(this->disconnect_reason));
@@ -149,6 +187,9 @@ namespace ace { namespace net {
     }
 
     void NetworkClient::on_receive(const ENetEvent &event) {
+        this->client.frame_stats.count("packets");
+        this->client.frame_stats.count("packet bytes", int(event.packet->dataLength));
+        if (this->recorder) this->recorder->record(event.packet->data, event.packet->dataLength);
         ByteReader br(event.packet->data, event.packet->dataLength);
         const auto packet_id = PACKET(br.read<uint8_t>());
         
@@ -157,6 +198,8 @@ namespace ace { namespace net {
             this->map_writer.clear();
             uint32_t siz = br.read<uint32_t>();
             this->map_writer.vec.reserve(siz);
+            this->map_inflater = std::make_unique<StreamInflater>();
+            this->map_reader = std::make_unique<VXLStreamReader>();
             fmt::print("MAP START {}\n", siz);
             this->set_state(NetState::MAP_TRANSFER);
         } break;
@@ -166,6 +209,18 @@ namespace ace { namespace net {
             size_t len;
             uint8_t *data = br.get(&len);
             this->map_writer.write(data, len);
+
+            if (this->map_reader) {
+                try {
+                    const auto &buf = this->map_inflater->feed(data, len);
+                    this->map_reader->feed(buf.data(), buf.size());
+                } catch (const std::exception &ex) {
+                    // the whole map gets inflated again once StateData arrives, so this isn't fatal
+                    fmt::print(stderr, "COULDN'T STREAM MAP, FALLING BACK: {}\n", ex.what());
+                    this->map_inflater.reset();
+                    this->map_reader.reset();
+                }
+            }
         } break;
         default: {
             auto packet = get_loader(packet_id);
@@ -180,6 +235,8 @@ namespace ace { namespace net {
     }
 
     void NetworkClient::send_packet(PACKET id, const Loader &pkt, enet_uint32 flags) const {
+        // there's no server to send to while a demo is playing
+        if (this->demo) return;
         ByteWriter writer;
         writer.write(static_cast<uint8_t>(id));
         pkt.write(writer);
@@ -25,11 +25,15 @@ namespace ace { namespace scene {
     }
 
     GameScene::GameScene(GameClient &client, const net::StateData &state_data, std::string ply_name, uint8_t *buf) :
+        GameScene(client, state_data, std::move(ply_name), std::make_unique<AceMap>(buf)) {
+    }
+
+    GameScene::GameScene(GameClient &client, const net::StateData &state_data, std::string ply_name, std::unique_ptr<AceMap> vxl) :
         Scene(client),
         shaders(*client.shaders),
         uniforms(this->shaders.create_ubo<SceneUniforms>("SceneUniforms")),
         cam(*this, { 256, 0, 256 }, { 0, -1, 0 }),
-        map(*this, buf),
+        map(*this, std::move(*vxl)),
         hud(*this),
         state_data(state_data),
         teams({ {net::TEAM::TEAM1, Team(state_data.team1_name, state_data.team1_color, net::TEAM::TEAM1)},
@@ -43,6 +47,7 @@ namespace ace { namespace scene {
         // If anything, that < really should be a > but oh well.
 
         this->set_fog_color(glm::vec3(state_data.fog_color) / 255.f);
+        this->set_fog_distance(this->client.config.json["graphics"].value("fog_distance", 128.0f));
 
         this->respawn_entities();
 
@@ -78,7 +83,10 @@ namespace ace { namespace scene {
 
         this->shaders.map.bind();
         this->shaders.map.uniform("model"_u = glm::mat4(1.0), "alpha"_u = 1.0f, "replacement_color"_u = glm::vec3(0.f));
-        this->map.draw(this->shaders.map);
+        {
+            util::ProfileZone zone(this->client.profiler, "map", true);
+            this->map.draw(this->shaders.map);
+        }
 
         this->shaders.model.bind();
         for (auto &kv : this->players) {
@@ -99,8 +107,11 @@ namespace ace { namespace scene {
         if(this->ply) 
             this->debug.draw_ray(vox2draw(this->ply->e), this->ply->draw_forward * 25.f, this->get_team(this->ply->team).float_color);
 
-        this->shaders.billboard.bind();
-        this->billboards.flush(this->shaders.billboard);
+        {
+            util::ProfileZone zone(this->client.profiler, "billboards", true);
+            this->shaders.billboard.bind();
+            this->billboards.flush(this->shaders.billboard);
+        }
 
         this->shaders.line.bind();
         this->debug.flush(this->cam.matrix(), this->shaders.line);
@@ -112,6 +123,7 @@ namespace ace { namespace scene {
             this->ply->draw();
         }
 
+        util::ProfileZone zone(this->client.profiler, "hud", true);
         hud.draw();
     }
 
@@ -148,6 +160,10 @@ namespace ace { namespace scene {
         }
 
         hud.update(dt);
+
+        this->client.frame_stats.set("players", int(this->players.size()));
+        this->client.frame_stats.set("entities", int(this->entities.size()));
+        this->client.frame_stats.set("objects", int(this->objects.size()));
     }
 
     void GameScene::on_key(SDL_Scancode scancode, int modifiers, bool pressed) {
@@ -177,6 +193,7 @@ namespace ace { namespace scene {
             case SDL_SCANCODE_7: wep = net::WEAPON::SHOTGUN; break;
             case SDL_SCANCODE_F2: this->thirdperson = !this->thirdperson; break;
             case SDL_SCANCODE_F3: if(this->ply) this->ply->alive = !this->ply->alive; break;
+            case SDL_SCANCODE_F4: this->map.set_greedy_meshing(!this->map.greedy_meshing); break;
             default: break;
             }
 
@@ -262,11 +279,14 @@ namespace ace { namespace scene {
         case net::PACKET::BlockLine: {
             net::BlockLine *pkt = static_cast<net::BlockLine *>(loader);
             auto *ply = this->get_ply(pkt->pid);
-            std::vector<glm::ivec3> blocks = this->map.block_line(pkt->start, pkt->end);
-            ply->blocks.primary_ammo = std::max(0, ply->blocks.primary_ammo - int(blocks.size()));
-            for(auto &block : blocks) {
+            int count = 0;
+            this->map.begin_edit();
+            this->map.block_line(pkt->start, pkt->end, [&](const glm::ivec3 &block) {
                 this->build_point(block.x, block.y, block.z, ply ? ply->color : this->block_colors[pkt->pid], true);
-            }
+                count++;
+            });
+            this->map.commit_edit();
+            ply->blocks.primary_ammo = std::max(0, ply->blocks.primary_ammo - count);
         } break;
         case net::PACKET::InputData: {
             net::InputData *pkt = static_cast<net::InputData *>(loader);
@@ -459,6 +479,8 @@ namespace ace { namespace scene {
         }
 
         std::vector<VXLBlock> v;
+        // everything this knocks loose gets meshed, lit and drawn on the minimap in one go
+        map.begin_edit();
         bool ok = map.destroy_point(x, y, z, v);
         switch(type) {
         case net::ACTION::SPADE:
@@ -477,6 +499,7 @@ namespace ace { namespace scene {
         default:
             break;
         }
+        map.commit_edit();
         if (!v.empty()) {
             this->create_object<world::FallingBlocks>(v);
 //            objects.emplace_back(std::make_unique<world::FallingBlocks>(*this, v));
@@ -498,7 +521,7 @@ namespace ace { namespace scene {
 
     void GameScene::set_zoom(bool zoom) {
         this->cam.sensitivity = zoom ? this->cam.zoom_sensitivity : this->cam.normal_sensitivity;
-        this->cam.set_projection(zoom ? 37.5f : 75.0f, this->client.width(), this->client.height(), 0.1f, 128.f);
+        this->cam.set_projection(zoom ? 37.5f : 75.0f, this->client.width(), this->client.height(), 0.1f, this->fog_distance);
     }
 
     void GameScene::send_block_action(int x, int y, int z, net::ACTION type) const {
@@ -606,4 +629,10 @@ namespace ace { namespace scene {
         this->uniforms->light_pos = normalize(glm::vec3{ -0.16, 0.8, 0.56 });
         this->uniforms->fog_color = color;
     }
+
+    void GameScene::set_fog_distance(float distance) {
+        this->fog_distance = distance;
+        this->uniforms->fog_start = distance / 2;
+        this->uniforms->fog_end = distance;
+    }
 }}
@@ -264,6 +264,7 @@ namespace ace { namespace scene {
         
         
         this->map_display.draw();
+        this->draw_profiler();
 
         this->scene.shaders.sprite.bind();
         this->scene.shaders.sprite.uniform("projection", projection);
@@ -289,6 +290,14 @@ namespace ace { namespace scene {
             this->state = State::ChangeTeam;
         } else if (scancode == this->scene.client.config.get_key("change_weapon")) {
             this->state = State::ChangeWeapon;
+        } else if (scancode == this->scene.client.config.get_key("profiler", SDL_SCANCODE_F7)) {
+            this->scene.client.profiler.enabled = !this->scene.client.profiler.enabled;
+        } else if (scancode == this->scene.client.config.get_key("profiler_dump", SDL_SCANCODE_F8)) {
+            if (this->scene.client.profiler.dump_trace("profile.json")) {
+                this->add_chat_message("Wrote profile.json", { 1, 1, 0 });
+            } else {
+                this->add_chat_message("Couldn't write profile.json", { 1, 0, 0 });
+            }
         }
 
         if(this->state == State::Exit) {
@@ -439,6 +448,62 @@ namespace ace { namespace scene {
         }
     }
 
+    // averages of the last second or so of frames in the top right, with a graph of the frame times under it
+    void HUD::draw_profiler() {
+        const util::Profiler &profiler = this->scene.client.profiler;
+        const util::Profiler::Frame *last = profiler.frame(0);
+        if (!profiler.enabled || !last) return;
+
+        constexpr int AVERAGE_FRAMES = 60, GRAPH_FRAMES = 120;
+        const float x = this->scene.client.width() - 260.f;
+        float y = 20;
+
+        double frame_time = 0;
+        int frames = 0;
+        for (; frames < AVERAGE_FRAMES && profiler.frame(frames); frames++) {
+            frame_time += profiler.frame(frames)->end - profiler.frame(frames)->start;
+        }
+        this->sys13->draw(fmt::format("FRAME {:6.2f} ms ({} frames)", frame_time / frames / 1000, frames), { x, y }, { 1, 1, 0 }, { 1, 1 }, draw::Align::TOP_LEFT);
+        y += 15;
+
+        // zones are matched by name and depth, so a zone only some frames have still averages right
+        for (const auto &zone : last->zones) {
+            double cpu = 0, gpu = 0;
+            int gpu_frames = 0;
+            for (int age = 0; age < frames; age++) {
+                const util::Profiler::Frame *f = profiler.frame(age);
+                for (const auto &z : f->zones) {
+                    if (z.name != zone.name || z.depth != zone.depth) continue;
+                    cpu += z.end - z.start;
+                    if (z.query != -1 && !f->gpu_pending) {
+                        gpu += (z.gpu_end - z.gpu_start) / 1000.0;
+                        gpu_frames++;
+                    }
+                }
+            }
+
+            const std::string name = std::string(zone.depth * 2, ' ') + zone.name;
+            std::string str = fmt::format("{:<18} {:6.2f}", name, cpu / frames / 1000);
+            if (gpu_frames) str += fmt::format(" gpu {:6.2f}", gpu / gpu_frames / 1000);
+            this->sys13->draw(str, { x, y }, glm::vec3(1), { 1, 1 }, draw::Align::TOP_LEFT);
+            y += 15;
+        }
+
+        // one line per frame, 2 px per ms, with marks at 60 and 30 fps
+        const float bottom = y + 80;
+        for (int age = 0; age < GRAPH_FRAMES && profiler.frame(age); age++) {
+            const util::Profiler::Frame *f = profiler.frame(age);
+            const float ms = float(f->end - f->start) / 1000, gx = x + 240 - age * 2;
+            const glm::vec3 color = ms < 16.7f ? glm::vec3(0, 1, 0) : ms < 33.3f ? glm::vec3(1, 1, 0) : glm::vec3(1, 0, 0);
+            this->profiler_lines.draw_line({ gx, bottom, 0 }, { gx, bottom - std::min(ms * 2, 80.f), 0 }, color);
+        }
+        this->profiler_lines.draw_line({ x, bottom - 16.7f * 2, 0 }, { x + 240, bottom - 16.7f * 2, 0 }, glm::vec3(0.5f));
+        this->profiler_lines.draw_line({ x, bottom - 33.3f * 2, 0 }, { x + 240, bottom - 33.3f * 2, 0 }, glm::vec3(0.5f));
+
+        this->scene.shaders.line.bind();
+        this->profiler_lines.flush(this->projection, this->scene.shaders.line);
+    }
+
     inline void draw_scoreboard_players(Team &team, glm::vec2 offset, draw::Align alignment, draw::Font *f) {
         for (auto i = team.players.begin(); i != team.players.end(); ++i) {
             auto *ply = *i;
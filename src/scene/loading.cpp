@@ -51,11 +51,14 @@ namespace ace { namespace scene {
         GUIPanel::draw();
     }
 
-    LoadingScene::LoadingScene(GameClient& client, const std::string &address):
+    LoadingScene::LoadingScene(GameClient& client, const std::string &address): LoadingScene(client, net::Server(address)) {
+    }
+
+    LoadingScene::LoadingScene(GameClient& client, net::Server server):
         Scene(client),
         font(client.fonts.get("fixedsys.ttf", 48, false)),
         aldo(client.fonts.get("AldotheApache.ttf", 48)),
-        server(address),
+        server(std::move(server)),
         background(client.sprites.get("main.png")),
         frame(*this) {
 
@@ -138,12 +141,26 @@ namespace ace { namespace scene {
 
     void LoadingScene::on_packet(net::PACKET type, std::unique_ptr<net::Loader> packet) {
         if(type == net::PACKET::StateData) {
-            auto buf(net::inflate(client.net.map_writer.vec.data(), client.net.map_writer.vec.size()));
-            this->game_scene = std::make_unique<GameScene>(this->client, *reinterpret_cast<net::StateData *>(packet.get()), this->client.config.json.value("name", "Deuce").substr(0, 15), buf.data());
+            std::unique_ptr<AceMap> map;
+            if (client.net.map_reader && client.net.map_reader->done()) {
+                // already decoded while the chunks were arriving
+                map = std::move(client.net.map_reader->map);
+            } else {
+                // the half decoded map goes first, no point having two of them around
+                client.net.map_reader.reset();
+                auto buf(net::inflate(client.net.map_writer.vec.data(), client.net.map_writer.vec.size()));
+                map = std::make_unique<AceMap>(buf.data());
+            }
+            client.net.map_inflater.reset();
+            client.net.map_reader.reset();
+
+            this->game_scene = std::make_unique<GameScene>(this->client, *reinterpret_cast<net::StateData *>(packet.get()), this->client.config.json.value("name", "Deuce").substr(0, 15), std::move(map));
             this->frame.start_button->enable(true);
             this->frame.frame.set_title("READY!");
             this->frame.status_text.set_str("Ready.");
             this->client.sound.stop_music();
+            // nobody's there to press start during a demo. not from in here though, start_game() destroys this scene
+            if (this->client.net.demo) this->client.tasks.call_later(0.0, [this] { this->start_game(); });
         } else {
             this->saved_loaders.emplace_back(type, std::move(packet));
         }
@@ -0,0 +1,102 @@
+#include "util/frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "fmt/format.h"
+
+namespace ace { namespace util {
+    int &FrameStats::counter(const char *name) {
+        // a handful of names, a linear search beats a map here
+        for (auto &c : this->counters) {
+            if (c.first == name || strcmp(c.first, name) == 0) return c.second;
+        }
+        this->counters.emplace_back(name, 0);
+        return this->counters.back().second;
+    }
+
+    void FrameStats::count(const char *name, int n) {
+        this->counter(name) += n;
+    }
+
+    void FrameStats::set(const char *name, int n) {
+        this->counter(name) = n;
+    }
+
+    void FrameStats::end_frame(double ms) {
+        const int bucket = std::min(int(ms / BUCKET_MS), BUCKETS - 1);
+        this->histogram[std::max(bucket, 0)]++;
+        this->total++;
+        this->max_ms = std::max(this->max_ms, ms);
+        this->time += ms / 1000;
+
+        // the first second or so is loading and shader compiles, there isn't a useful median yet
+        if (this->total % 60 == 0) this->median = this->percentile(0.5);
+        if (this->median > 0 && ms > this->median * SPIKE_FACTOR) {
+            if (this->spikes.size() < MAX_SPIKES) {
+                this->spikes.push_back({ this->total, this->time, ms, this->counters });
+            } else {
+                this->dropped_spikes++;
+            }
+        }
+
+        // keep the names around so the next frame doesn't allocate
+        for (auto &c : this->counters) c.second = 0;
+    }
+
+    double FrameStats::percentile(double p) const {
+        if (this->total == 0) return 0;
+        const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(p * this->total)));
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += this->histogram[i];
+            if (seen >= rank) return std::min((i + 1) * BUCKET_MS, this->max_ms);
+        }
+        return this->max_ms;
+    }
+
+    bool FrameStats::write_csv(const std::string &histogram_path, const std::string &spikes_path) const {
+        FILE *f = fopen(histogram_path.c_str(), "w");
+        if (!f) return false;
+        fmt::print(f, "ms,frames,fraction\n");
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            if (this->histogram[i] == 0) continue;
+            seen += this->histogram[i];
+            fmt::print(f, "{:.2f},{},{:.5f}\n", (i + 1) * BUCKET_MS, this->histogram[i], double(seen) / this->total);
+        }
+        fclose(f);
+
+        f = fopen(spikes_path.c_str(), "w");
+        if (!f) return false;
+        // not every spike saw every counter, so the columns are every name any of them had
+        std::vector<const char *> names;
+        for (const auto &s : this->spikes) {
+            for (const auto &c : s.counters) {
+                if (std::none_of(names.begin(), names.end(), [&c](const char *n) { return strcmp(n, c.first) == 0; })) {
+                    names.push_back(c.first);
+                }
+            }
+        }
+
+        fmt::print(f, "frame,time,ms");
+        for (const char *name : names) fmt::print(f, ",{}", name);
+        fmt::print(f, "\n");
+        for (const auto &s : this->spikes) {
+            fmt::print(f, "{},{:.3f},{:.2f}", s.frame, s.time, s.ms);
+            for (const char *name : names) {
+                const auto it = std::find_if(s.counters.begin(), s.counters.end(), [name](const std::pair<const char *, int> &c) { return strcmp(c.first, name) == 0; });
+                fmt::print(f, ",{}", it == s.counters.end() ? 0 : it->second);
+            }
+            fmt::print(f, "\n");
+        }
+        fclose(f);
+
+        if (this->dropped_spikes != 0) {
+            fmt::print("{} SPIKES NOT WRITTEN, ONLY THE FIRST {} ARE KEPT\n", this->dropped_spikes, size_t(MAX_SPIKES));
+        }
+        return true;
+    }
+}}
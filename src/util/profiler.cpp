@@ -0,0 +1,126 @@
+#include "util/profiler.h"
+
+#include <cstdio>
+
+#include "fmt/format.h"
+
+namespace ace { namespace util {
+    Profiler::Profiler() : epoch(std::chrono::steady_clock::now()), frames(MAX_FRAMES) {
+    }
+
+    double Profiler::now() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - this->epoch).count();
+    }
+
+    void Profiler::begin_frame() {
+        this->recording = this->enabled;
+        if (!this->recording) return;
+
+        Frame &f = this->frames[this->current];
+        // only happens if the driver is MAX_FRAMES frames behind, but the queries can't be reused before they're read
+        if (f.gpu_pending) this->read_queries(f, true);
+
+        f.number = ++this->frame_count;
+        f.zones.clear();
+        f.used_queries = 0;
+        glGetInteger64v(GL_TIMESTAMP, &f.gpu_base);
+        f.start = this->now();
+        this->stack.clear();
+    }
+
+    void Profiler::end_frame() {
+        if (!this->recording) return;
+
+        while (!this->stack.empty()) this->pop();
+
+        Frame &f = this->frames[this->current];
+        f.end = this->now();
+        f.gpu_pending = f.used_queries != 0;
+        this->current = (this->current + 1) % MAX_FRAMES;
+        this->recording = false;
+
+        // oldest first, once one isn't back yet the newer ones won't be either
+        for (int age = MAX_FRAMES - 1; age >= 0; age--) {
+            Frame &old = this->frames[(this->current + MAX_FRAMES - 1 - age) % MAX_FRAMES];
+            if (old.gpu_pending && !this->read_queries(old, false)) break;
+        }
+    }
+
+    void Profiler::push(const char *name, bool gpu) {
+        if (!this->recording) return;
+
+        Frame &f = this->frames[this->current];
+        int query = -1;
+        if (gpu) {
+            query = f.used_queries;
+            f.used_queries += 2;
+            while (int(f.queries.size()) < f.used_queries) f.queries.emplace_back();
+            glQueryCounter(f.queries[query], GL_TIMESTAMP);
+        }
+
+        this->stack.push_back(int(f.zones.size()));
+        f.zones.push_back({ name, int(this->stack.size()) - 1, this->now(), 0, query, 0, 0 });
+    }
+
+    void Profiler::pop() {
+        if (!this->recording || this->stack.empty()) return;
+
+        Frame &f = this->frames[this->current];
+        Zone &z = f.zones[this->stack.back()];
+        this->stack.pop_back();
+        z.end = this->now();
+        if (z.query != -1) glQueryCounter(f.queries[z.query + 1], GL_TIMESTAMP);
+    }
+
+    bool Profiler::read_queries(Frame &f, bool wait) {
+        if (!wait) {
+            GLint available = 0;
+            glGetQueryObjectiv(f.queries[f.used_queries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return false;
+        }
+
+        for (Zone &z : f.zones) {
+            if (z.query == -1) continue;
+            GLint64 start, end;
+            glGetQueryObjecti64v(f.queries[z.query], GL_QUERY_RESULT, &start);
+            glGetQueryObjecti64v(f.queries[z.query + 1], GL_QUERY_RESULT, &end);
+            z.gpu_start = start;
+            z.gpu_end = end;
+        }
+        f.gpu_pending = false;
+        return true;
+    }
+
+    const Profiler::Frame *Profiler::frame(int age) const {
+        if (age < 0 || age >= MAX_FRAMES - 1) return nullptr;
+        const Frame &f = this->frames[(this->current + MAX_FRAMES - 1 - age) % MAX_FRAMES];
+        // slots only move on recorded frames, so this is only empty until the profiler has been on for that long
+        if (f.number == 0) return nullptr;
+        return &f;
+    }
+
+    bool Profiler::dump_trace(const std::string &file_path) const {
+        FILE *out = fopen(file_path.c_str(), "w");
+        if (!out) return false;
+
+        // cpu zones on one track and gpu zones on another, both in us
+        fmt::print(out, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        fmt::print(out, "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{{\"name\":\"cpu\"}}}},\n");
+        fmt::print(out, "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{{\"name\":\"gpu\"}}}}");
+        for (int age = MAX_FRAMES - 2; age >= 0; age--) {
+            const Frame *f = this->frame(age);
+            if (!f) continue;
+
+            fmt::print(out, ",\n{{\"name\":\"frame {}\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":{:.3f},\"dur\":{:.3f}}}", f->number, f->start, f->end - f->start);
+            for (const Zone &z : f->zones) {
+                fmt::print(out, ",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":{:.3f},\"dur\":{:.3f}}}", z.name, z.start, z.end - z.start);
+                if (z.query == -1 || f->gpu_pending) continue;
+                const double start = f->start + (z.gpu_start - f->gpu_base) / 1000.0;
+                fmt::print(out, ",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":{:.3f},\"dur\":{:.3f}}}", z.name, start, (z.gpu_end - z.gpu_start) / 1000.0);
+            }
+        }
+        fmt::print(out, "\n]}}\n");
+        fclose(out);
+        return true;
+    }
+}}
@@ -0,0 +1,59 @@
+#include "util/worker_pool.h"
+
+#include <algorithm>
+
+namespace ace { namespace util {
+    WorkerPool::WorkerPool(unsigned threads) {
+        if (threads == 0) {
+            threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+
+        for (unsigned i = 0; i < threads; i++) {
+            this->threads.emplace_back(&WorkerPool::run, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->stopping = true;
+            this->jobs.clear();
+        }
+        this->cv.notify_all();
+        for (auto &t : this->threads) {
+            t.join();
+        }
+    }
+
+    void WorkerPool::push(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->jobs.push_back(std::move(job));
+        }
+        this->cv.notify_one();
+    }
+
+    void WorkerPool::wait() {
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->idle.wait(guard, [this] { return this->jobs.empty() && this->running == 0; });
+    }
+
+    void WorkerPool::run() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> guard(this->lock);
+                this->cv.wait(guard, [this] { return this->stopping || !this->jobs.empty(); });
+                if (this->stopping) return;
+
+                job = std::move(this->jobs.front());
+                this->jobs.pop_front();
+                this->running++;
+            }
+            job();
+
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (--this->running == 0 && this->jobs.empty()) this->idle.notify_all();
+        }
+    }
+}}
@@ -3,7 +3,9 @@
 
 #include <random>
 #include <chrono> 
-#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+#include <thread>
 
 #include "fmt/printf.h"
 
@@ -49,63 +51,182 @@ namespace ace {
         return glm::u8vec3(unpack_argb(col));
     }
 
-    AceMap::AceMap(uint8_t *buf) {
+    AceMap::AceMap(uint8_t *buf) : geometry(MAP_X * MAP_Y) {
         this->nodes.reserve(512);
+        this->gen_heights();
         this->read(buf);
     }
 
-    void AceMap::read(uint8_t *buf) {
+    void AceMap::read(uint8_t *buf, unsigned threads) {
         fmt::print("READING MAP\n");
         if (!buf) return;
 
         auto start = std::chrono::high_resolution_clock::now();
-        this->geometry.set();
-        this->colors.clear();
-        this->colors.reserve(MAP_X * MAP_Y * 16); // just a guess tbh
 
-        for (int y = 0; y < MAP_Y; ++y) {
-            for (int x = 0; x < MAP_X; ++x) {
-                int z = 0;
-                while (true) {
-                    int number_4byte_chunks = buf[0];
-                    int top_color_start = buf[1];
-                    int top_color_end = buf[2]; // inclusive
+        // first pass only walks the span headers to find where every column starts,
+        // which lets the columns be decoded independently (and in any order) afterwards.
+        std::vector<uint8_t *> columns(MAP_X * MAP_Y);
+        for (auto &column : columns) {
+            column = buf;
+            buf += column_size(buf);
+        }
 
-                    for (int i = z; i < top_color_start; i++)
-                        this->geometry[get_pos(x, y, i)] = false;
+        std::fill(this->geometry.begin(), this->geometry.end(), ~uint64_t(0));
+        this->alloc_colors();
 
-                    uint32_t *color = reinterpret_cast<uint32_t *>(&buf[4]);
-                    for (z = top_color_start; z <= top_color_end; z++) {
-                        this->colors[get_pos(x, y, z)] = (0x7F << 24) | (*color++ & 0x00FFFFFF);
-                    }
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::min<unsigned>(threads, MAP_Y);
+
+        // every column owns its own geometry word and 64 colors (see get_pos), so splitting the map
+        // by rows never has two threads touching the same word and the result is identical to a serial read.
+        auto decode_rows = [this, &columns](int y1, int y2) {
+            for (int y = y1; y < y2; ++y) {
+                for (int x = 0; x < MAP_X; ++x) {
+                    this->read_column(x, y, columns[x + y * MAP_X]);
+                }
+            }
+        };
 
-                    int len_bottom = top_color_end - top_color_start + 1;
+        std::vector<std::thread> workers;
+        const int rows = (MAP_Y + threads - 1) / threads;
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(decode_rows, std::min<int>(i * rows, MAP_Y), std::min<int>((i + 1) * rows, MAP_Y));
+        }
+        decode_rows(0, rows);
+        for (auto &worker : workers) {
+            worker.join();
+        }
 
-                    // check for end of data marker
-                    if (number_4byte_chunks == 0) {
-                        // infer ACTUAL number of 4-byte chunks from the length of the color data
-                        buf += 4 * (len_bottom + 1);
-                        break;
-                    }
+        auto end = std::chrono::high_resolution_clock::now();
 
-                    // infer the number of bottom colors in next span from chunk length
-                    int len_top = (number_4byte_chunks - 1) - len_bottom;
+        this->gen_heights();
 
-                    // now skip the v pointer past the data to the beginning of the next span
-                    buf += buf[0] * 4;
+        fmt::print("MAP READ TIME: {} ({} threads)\n", std::chrono::duration<double>(end - start).count(), threads);
+    }
 
-                    int bottom_color_end = buf[3]; // aka air start
-                    int bottom_color_start = bottom_color_end - len_top;
+    void AceMap::gen_heights() {
+        for (int i = 0; i < HEIGHT_LEVELS; i++) {
+            const size_t size = MAP_X >> (2 * i);
+            this->heights[i].assign(size * size, uint8_t(MAP_Z));
+        }
+        for (size_t i = 0; i < this->geometry.size(); i++) {
+            this->heights[0][i] = uint8_t(column_top(this->geometry[i]));
+        }
+        for (int i = 1; i < HEIGHT_LEVELS; i++) {
+            const size_t size = MAP_X >> (2 * i), below = size * 4;
+            for (size_t y = 0; y < below; y++) {
+                for (size_t x = 0; x < below; x++) {
+                    uint8_t &h = this->heights[i][x / 4 + y / 4 * size];
+                    h = std::min(h, this->heights[i - 1][x + y * below]);
+                }
+            }
+        }
+    }
 
-                    for (z = bottom_color_start; z < bottom_color_end; ++z) {
-                        this->colors[get_pos(x, y, z)] = (0x7F << 24) | (*color++ & 0x00FFFFFF);
-                    }
+    void AceMap::update_height(int x, int y) {
+        uint8_t h = uint8_t(column_top(this->geometry[x + y * MAP_X]));
+        if (this->heights[0][x + y * MAP_X] == h) return;
+        this->heights[0][x + y * MAP_X] = h;
+
+        for (int i = 1; i < HEIGHT_LEVELS; i++) {
+            const size_t size = MAP_X >> (2 * i), below = size * 4;
+            x /= 4;
+            y /= 4;
+            h = MAP_Z;
+            for (int cy = y * 4; cy < y * 4 + 4; cy++) {
+                for (int cx = x * 4; cx < x * 4 + 4; cx++) {
+                    h = std::min(h, this->heights[i - 1][cx + cy * below]);
                 }
             }
+            if (this->heights[i][x + y * size] == h) return;
+            this->heights[i][x + y * size] = h;
         }
-        auto end = std::chrono::high_resolution_clock::now();
+    }
 
-        fmt::print("MAP READ TIME: {}\n", std::chrono::duration<double>(end - start).count());
+    size_t AceMap::column_size(const uint8_t *buf, size_t len) {
+        size_t pos = 0;
+        while (pos + 4 <= len) {
+            if (buf[pos] == 0) {
+                // last span has no chunk count, its length is inferred from the top colors
+                const size_t end = pos + 4 * (buf[pos + 2] - buf[pos + 1] + 2);
+                return end <= len ? end : 0;
+            }
+            pos += buf[pos] * 4;
+        }
+        return 0;
+    }
+
+    void AceMap::alloc_colors() {
+        if (this->colors.empty()) this->colors.resize(MAP_X * MAP_Y * MAP_Z);
+    }
+
+    void AceMap::read_column(int x, int y, const uint8_t *buf) {
+        std::fill_n(this->colors.begin() + get_pos(x, y, 0), MAP_Z, 0);
+
+        int z = 0;
+        while (true) {
+            int number_4byte_chunks = buf[0];
+            int top_color_start = buf[1];
+            int top_color_end = buf[2]; // inclusive
+
+            for (int i = z; i < top_color_start; i++)
+                this->set_solid(get_pos(x, y, i), false);
+
+            const uint32_t *color = reinterpret_cast<const uint32_t *>(&buf[4]);
+            for (z = top_color_start; z <= top_color_end; z++) {
+                this->colors[get_pos(x, y, z)] = (0x7F << 24) | (*color++ & 0x00FFFFFF);
+            }
+
+            int len_bottom = top_color_end - top_color_start + 1;
+
+            // check for end of data marker
+            if (number_4byte_chunks == 0) {
+                // infer ACTUAL number of 4-byte chunks from the length of the color data
+                buf += 4 * (len_bottom + 1);
+                break;
+            }
+
+            // infer the number of bottom colors in next span from chunk length
+            int len_top = (number_4byte_chunks - 1) - len_bottom;
+
+            // now skip the v pointer past the data to the beginning of the next span
+            buf += buf[0] * 4;
+
+            int bottom_color_end = buf[3]; // aka air start
+            int bottom_color_start = bottom_color_end - len_top;
+
+            for (z = bottom_color_start; z < bottom_color_end; ++z) {
+                this->colors[get_pos(x, y, z)] = (0x7F << 24) | (*color++ & 0x00FFFFFF);
+            }
+        }
+    }
+
+    VXLStreamReader::VXLStreamReader() : map(std::make_unique<AceMap>()) {
+        std::fill(this->map->geometry.begin(), this->map->geometry.end(), ~uint64_t(0));
+    }
+
+    void VXLStreamReader::feed(const uint8_t *data, size_t len) {
+        if (this->done()) return;
+
+        this->pending.insert(this->pending.end(), data, data + len);
+        this->map->alloc_colors();
+
+        size_t pos = 0;
+        while (!this->done()) {
+            const size_t size = AceMap::column_size(this->pending.data() + pos, this->pending.size() - pos);
+            if (size == 0) break;
+
+            this->map->read_column(this->column % MAP_X, this->column / MAP_X, this->pending.data() + pos);
+            this->column++;
+            pos += size;
+        }
+        if (this->done()) {
+            this->map->gen_heights();
+        }
+        // whatever is left is the start of a column we haven't received all of yet
+        this->pending.erase(this->pending.begin(), this->pending.begin() + pos);
     }
 
     std::vector<uint8_t> AceMap::write() {
@@ -131,7 +252,7 @@ namespace ace {
                 while (z < MAP_Z) {
                     // find the air region
                     int air_start = z;
-                    while (z < MAP_Z && !this->geometry[get_pos(x, y, z)])
+                    while (z < MAP_Z && !this->solid_at(get_pos(x, y, z)))
                         ++z;
 
                     // find the top region
@@ -141,7 +262,7 @@ namespace ace {
                     int top_colors_end = z;
 
                     // now skip past the solid voxels
-                    while (z < MAP_Z && this->geometry[get_pos(x, y, z)] && !this->is_surface(x, y, z))
+                    while (z < MAP_Z && this->solid_at(get_pos(x, y, z)) && !this->is_surface(x, y, z))
                         ++z;
 
                     // at the end of the solid voxels, we have colored voxels.
@@ -195,13 +316,13 @@ namespace ace {
     }
 
     bool AceMap::is_surface(const int x, const int y, const int z) {
-        if (!this->geometry[get_pos(x, y, z)]) return false;
-        if (x     >     0 && !this->geometry[get_pos(x - 1, y, z)]) return true;
-        if (x + 1 < MAP_X && !this->geometry[get_pos(x + 1, y, z)]) return true;
-        if (y     >     0 && !this->geometry[get_pos(x, y - 1, z)]) return true;
-        if (y + 1 < MAP_Y && !this->geometry[get_pos(x, y + 1, z)]) return true;
-        if (z     >     0 && !this->geometry[get_pos(x, y, z - 1)]) return true;
-        if (z + 1 < MAP_Z && !this->geometry[get_pos(x, y, z + 1)]) return true;
+        if (!this->solid_at(get_pos(x, y, z))) return false;
+        if (x     >     0 && !this->solid_at(get_pos(x - 1, y, z))) return true;
+        if (x + 1 < MAP_X && !this->solid_at(get_pos(x + 1, y, z))) return true;
+        if (y     >     0 && !this->solid_at(get_pos(x, y - 1, z))) return true;
+        if (y + 1 < MAP_Y && !this->solid_at(get_pos(x, y + 1, z))) return true;
+        if (z     >     0 && !this->solid_at(get_pos(x, y, z - 1))) return true;
+        if (z + 1 < MAP_Z && !this->solid_at(get_pos(x, y, z + 1))) return true;
         return false;
     }
 
@@ -213,7 +334,7 @@ namespace ace {
         if (!is_valid_pos(x, y, z))
             return false;
         ;
-        return this->geometry[get_pos(x, y, z)];
+        return this->solid_at(get_pos(x, y, z));
     }
 
     uint32_t AceMap::get_color(int x, int y, int z, bool wrapped) {
@@ -223,17 +344,18 @@ namespace ace {
         }
         if (!is_valid_pos(x, y, z)) return 0;
 
-        auto pos = get_pos(x, y, z);
-        auto color = this->colors.find(pos);
-        if(color == this->colors.end()) {
-            return this->colors[pos] = dirtcolor(x, y, z);
+        this->alloc_colors();
+        uint32_t &color = this->colors[get_pos(x, y, z)];
+        if(color == 0) {
+            color = dirtcolor(x, y, z);
         }
-        return color->second;
+        return color;
     }
 
     int AceMap::get_z(const int x, const int y, const int start) const {
-        for (int z = start; z < MAP_Z; z++) {
-            if (this->get_solid(x, y, z)) return z;
+        const uint64_t column = this->get_column(x, y);
+        for (int z = std::max(start, 0); z < MAP_Z; z++) {
+            if (column >> z & 1) return z;
         }
         return MAP_Z;
     }
@@ -255,134 +377,109 @@ namespace ace {
         return p;
     }
 
-    std::vector<glm::ivec3> AceMap::block_line(const int x1, const int y1, const int z1, const int x2, const int y2, const int z2) const {
-        std::vector<glm::ivec3> ret;
+    bool AceMap::set_point(const int x, const int y, const int z, const bool solid, const uint32_t color) {
+        // get_pos of an out of range z (or x) is just a voxel in some other column, it has to be caught here
+        if (!is_valid_pos(x, y, z)) return false;
+        return this->set_point(get_pos(x, y, z), solid, color);
+    }
 
-        glm::ivec3 c{ x1, y1, z1 };
-        glm::ivec3 d{ x2 - x1, y2 - y1, z2 - z1 };
-        long ixi, iyi, izi, dx, dy, dz, dxi, dyi, dzi;
-        const size_t VSID = MAP_X;
+    bool AceMap::set_point(const size_t pos, const bool solid, const uint32_t color) {
+        if (!is_valid_pos(pos)) return false;
 
-        if (d.x < 0) ixi = -1;
-        else ixi = 1;
-        if (d.y < 0) iyi = -1;
-        else iyi = 1;
-        if (d.z < 0) izi = -1;
-        else izi = 1;
+        this->alloc_colors();
+        this->set_solid(pos, solid);
+        this->colors[pos] = solid ? colorjit(color) : 0;
+        this->update_height(pos / MAP_Z % MAP_X, pos / MAP_Z / MAP_X);
+        return true;
+    }
 
-        if ((abs(d.x) >= abs(d.y)) && (abs(d.x) >= abs(d.z)))
-        {
-            dxi = 1024; dx = 512;
-            dyi = static_cast<long>(!d.y ? 0x3fffffff / VSID : abs(d.x * 1024 / d.y));
-            dy = dyi / 2;
-            dzi = static_cast<long>(!d.z ? 0x3fffffff / VSID : abs(d.x * 1024 / d.z));
-            dz = dzi / 2;
-        }
-        else if (abs(d.y) >= abs(d.z))
-        {
-            dyi = 1024; dy = 512;
-            dxi = static_cast<long>(!d.x ? 0x3fffffff / VSID : abs(d.y * 1024 / d.x));
-            dx = dxi / 2;
-            dzi = static_cast<long>(!d.z ? 0x3fffffff / VSID : abs(d.y * 1024 / d.z));
-            dz = dzi / 2;
+    bool AceMap::check_node(int x, int y, int z, bool destroy, std::vector<VXLBlock> &destroyed) {
+        const glm::ivec3 start(x, y, z);
+        this->check_nodes(&start, 1, destroy, destroyed);
+        return this->marked.empty() || this->node_column(x, y).grounded >> z & 1;
+    }
+
+    void AceMap::check_nodes(const glm::ivec3 *starts, const int count, const bool destroy, std::vector<VXLBlock> &destroyed) {
+        if (this->node_columns.empty()) {
+            this->node_columns.resize(MAP_X * MAP_Y, { 0, 0, 0, 0 });
         }
-        else
-        {
-            dzi = 1024; dz = 512;
-            dxi = static_cast<long>(!d.x ? 0x3fffffff / VSID : abs(d.z * 1024 / d.x));
-            dx = dxi / 2;
-            dyi = static_cast<long>(!d.y ? 0x3fffffff / VSID : abs(d.z * 1024 / d.y));
-            dy = dyi / 2;
+        if (++this->node_pass == 0) {
+            for (auto &c : this->node_columns) c.pass = 0;
+            this->node_pass = 1;
         }
-        if (ixi >= 0) dx = dxi - dx;
-        if (iyi >= 0) dy = dyi - dy;
-        if (izi >= 0) dz = dzi - dz;
 
-        while (true) {
-            ret.push_back(c);
+        for (int i = 0; i < count; i++) {
+            if (this->search_ground(starts[i])) continue;
 
-            if (c.x == x2 &&
-                c.y == y2 &&
-                c.z == z2)
-                break;
-
-            if ((dz <= dx) && (dz <= dy))
-            {
-                c.z += izi;
-                if (c.z < 0 || c.z >= MAP_Z)
-                    break;
-                dz += dzi;
-            }
-            else
-            {
-                if (dx < dy)
-                {
-                    c.x += ixi;
-                    if (static_cast<unsigned long>(c.x) >= VSID)
-                        break;
-                    dx += dxi;
+            // destroy the node's path!
+            if (destroy) {
+                // need to iter twice to get proper visflags.
+                for (const auto &pos : marked) {
+                    if (this->get_solid(pos.x, pos.y, pos.z)) {
+                        destroyed.push_back({ pos, this->get_color(pos.x, pos.y, pos.z), this->get_vis(pos.x, pos.y, pos.z) });
+                    }
                 }
-                else
-                {
-                    c.y += iyi;
-                    if (static_cast<unsigned long>(c.y) >= VSID)
-                        break;
-                    dy += dyi;
+
+                for (const auto &pos : marked) {
+                    this->set_point(pos.x, pos.y, pos.z, false, 0);
                 }
             }
         }
-        return ret;
-    }
-
-    bool AceMap::set_point(const int x, const int y, const int z, const bool solid, const uint32_t color) {
-        return this->set_point(get_pos(x, y, z), solid, color);
     }
 
-    bool AceMap::set_point(const size_t pos, const bool solid, const uint32_t color) {
-        if (!is_valid_pos(pos)) return false;
-
-        this->geometry[pos] = solid;
-        if (solid)
-            this->colors[pos] = colorjit(color);
-        else
-            this->colors.erase(pos);
-        return true;
+    AceMap::NodeColumn &AceMap::node_column(const int x, const int y) {
+        NodeColumn &c = this->node_columns[x + y * MAP_X];
+        if (c.search != this->node_search) {
+            c.search = this->node_search;
+            c.visited = 0;
+        }
+        if (c.pass != this->node_pass) {
+            c.pass = this->node_pass;
+            c.grounded = 0;
+        }
+        return c;
     }
 
-    bool AceMap::check_node(int x, int y, int z, bool destroy, std::vector<VXLBlock> &destroyed) {
-        marked.clear();
-        nodes.clear();
-        nodes.emplace_back(x, y, z);
-
-        while (!nodes.empty()) {
-            const glm::ivec3 &node = nodes.back();
-            x = node.x; y = node.y; z = node.z;
-            nodes.pop_back();
-            if (z >= 62) {
-                return true;
-            }
+    // dfs from start until something on the ground turns up. marked ends up with everything visited,
+    // which is start's whole component if it's floating
+    bool AceMap::search_ground(const glm::ivec3 &start) {
+        this->marked.clear();
+        if (!is_valid_pos(start.x, start.y, start.z)) return true;
 
-            // already visited?
-            const auto ret = marked.emplace(x, y, z);
-            if (ret.second) {
-                this->add_neighbors(nodes, x, y, z);
-            }
+        if (++this->node_search == 0) {
+            for (auto &c : this->node_columns) c.search = 0;
+            this->node_search = 1;
         }
 
-        // destroy the node's path!
-        if (destroy) {
-            // need to iter twice to get proper visflags.
-            for (const auto &pos : marked) {
-                if (this->get_solid(pos.x, pos.y, pos.z)) {
-                    destroyed.push_back({ pos, this->get_color(pos.x, pos.y, pos.z), this->get_vis(pos.x, pos.y, pos.z) });
-                }
+        bool grounded = false;
+        this->nodes.clear();
+        this->nodes.push_back(start);
+        while (!this->nodes.empty()) {
+            const glm::ivec3 node = this->nodes.back();
+            this->nodes.pop_back();
+
+            NodeColumn &c = this->node_column(node.x, node.y);
+            const uint64_t bit = uint64_t(1) << node.z;
+            if (c.visited & bit) continue;
+            c.visited |= bit;
+            this->marked.push_back(node);
+
+            // on the ground, solid all the way down to it, or already found grounded by an earlier search this pass
+            const uint64_t down = (uint64_t(1) << 63) - bit;
+            if (node.z >= 62 || (this->geometry[node.x + node.y * MAP_X] & down) == down || c.grounded & bit) {
+                grounded = true;
+                break;
             }
+            this->add_neighbors(this->nodes, node.x, node.y, node.z);
+        }
 
-            for (const auto &pos : marked) {
-                this->set_point(pos.x, pos.y, pos.z, false, 0);
+        // everything visited is connected to start, so it's all on the ground too
+        if (grounded) {
+            for (const auto &pos : this->marked) {
+                this->node_column(pos.x, pos.y).grounded |= uint64_t(1) << pos.z;
             }
         }
-        return true;
+        return grounded;
     }
 
     bool AceMap::can_see(const glm::vec3 &position, const glm::vec3 &direction, long *x, long *y, long *z, float length, bool isdirection) const {
@@ -458,7 +555,7 @@ namespace ace {
     }
 
     // ken silverman is a wizard
-    Face AceMap::hitscan(const glm::dvec3 &p, const glm::dvec3 &d, glm::ivec3 *h) const {
+    Face AceMap::hitscan(const glm::dvec3 &p, const glm::dvec3 &d, glm::ivec3 *h, const bool accelerated) const {
         long ixi, iyi, izi, dx, dy, dz, dxi, dyi, dzi;
         float f, kx, ky, kz;
         const size_t VSID = MAP_X;
@@ -471,10 +568,10 @@ namespace ace {
             return Face::INVALID;
         }
 
-        // what the fuck?
-        ixi = ((signed long *)&d.x)[1] >> 31 | 1;
-        iyi = ((signed long *)&d.y)[1] >> 31 | 1;
-        izi = ((signed long *)&d.z)[1] >> 31 | 1;
+        // used to be the sign bit from the high half of the double through a long *, which breaks where long is 64 bit
+        ixi = std::signbit(d.x) ? -1 : 1;
+        iyi = std::signbit(d.y) ? -1 : 1;
+        izi = std::signbit(d.z) ? -1 : 1;
 
         f = 0x3fffffff / VSID;
         if((fabs(d.x) >= fabs(d.y)) && (fabs(d.x) >= fabs(d.z))) {
@@ -494,7 +591,58 @@ namespace ace {
         dyi = ky; dy = (p.y - (float)h->y) * ky; if (iyi >= 0) dy = dyi - dy;
         dzi = kz; dz = (p.z - (float)h->z) * kz; if (izi >= 0) dz = dzi - dz;
 
+        // does every step the loop below would take inside the biggest box of air around h at once, in the same order,
+        // so the next step it takes is the one out of the box
+        const auto skip_air = [&] {
+            if (!is_valid_pos(h->x, h->y, h->z)) return;
+
+            int shift = 0, top = this->heights[0][h->x + h->y * MAP_X];
+            if (h->z >= top) return;
+            for (int level = 1; level < HEIGHT_LEVELS; level++) {
+                const int s = 2 * level, t = this->heights[level][(h->x >> s) + (h->y >> s) * (MAP_X >> s)];
+                if (h->z >= t) break;
+                shift = s;
+                top = t;
+            }
+
+            const long long n[3] = {
+                ixi > 0 ? (((h->x >> shift) + 1) << shift) - 1 - h->x : h->x - ((h->x >> shift) << shift),
+                iyi > 0 ? (((h->y >> shift) + 1) << shift) - 1 - h->y : h->y - ((h->y >> shift) << shift),
+                izi > 0 ? top - 1 - h->z : h->z,
+            };
+            const long long t[3] = { dx, dy, dz }, step[3] = { dxi, dyi, dzi };
+
+            // the axis that leaves first, ties go z, y, x like in the loop
+            int out = 2;
+            long long out_t = t[2] + n[2] * step[2];
+            for (int a = 1; a >= 0; a--) {
+                if (t[a] + n[a] * step[a] < out_t) {
+                    out = a;
+                    out_t = t[a] + n[a] * step[a];
+                }
+            }
+
+            long long s[3];
+            for (int a = 0; a < 3; a++) {
+                if (a == out) {
+                    s[a] = n[a];
+                } else if (t[a] > out_t) {
+                    s[a] = 0;
+                } else {
+                    // steps at exactly out_t only come first if the axis goes before the one leaving
+                    s[a] = (out_t - t[a]) / step[a] + 1;
+                    if ((out_t - t[a]) % step[a] == 0 && a < out) s[a]--;
+                }
+            }
+
+            h->x += int(ixi * s[0]); dx += long(s[0] * dxi);
+            h->y += int(iyi * s[1]); dy += long(s[1] * dyi);
+            h->z += int(izi * s[2]); dz += long(s[2] * dzi);
+        };
+
         while (true) {
+            if (accelerated) skip_air();
+
             Face dir;
             if ((dz <= dx) && (dz <= dy)) {
                 h->z += izi; dz += dzi; dir = Face(5 - (izi>0));
@@ -190,12 +190,11 @@ namespace ace {
     void BlockTool::ghost_block_line() {
         if (!this->ply.local_player) return;
 
-        auto blocks(this->ply.scene.map.block_line(this->m1, this->m2));
-        std::vector<VXLBlock> d_blocks;
-        for (auto &x : blocks) {
-            d_blocks.push_back({ x, 0xFF000000 });
-        }
-        this->ghost_block->update(d_blocks, this->m2, true);
+        this->line_blocks.clear();
+        this->ply.scene.map.block_line(this->m1, this->m2, [this](const glm::ivec3 &x) {
+            this->line_blocks.push_back({ x, 0xFF000000 });
+        });
+        this->ghost_block->update(this->line_blocks, this->m2, true);
     }
 
     void BlockTool::transform() {
@@ -364,50 +363,37 @@ namespace ace {
 
         this->ply.play_sound(this->shoot_sound());
 
-        // stupid PYSPADES bans you if you spam BlockAction more than once per shot (shotgun creates problems)
-        bool block_destroyed = false;
-        for (int i = 0; i < this->pellets(); i++) {
-            glm::vec3 dir = this->ply.f;
+        std::vector<glm::vec3> dirs(this->pellets());
+        for (auto &dir : dirs) {
+            dir = this->ply.f;
             float spread = this->spread() * (this->ply.secondary_fire ? 1 : 2);
             dir += glm::vec3{ calc_spread(spread), calc_spread(spread), calc_spread(spread) };
             this->ply.scene.create_object<world::Tracer>(this->tracer(), this->ply.e + dir * 4.f, dir);
+        }
 
-            glm::ivec3 hit;
-            Face f = this->ply.scene.map.hitscan(this->ply.e, dir, &hit);
-            if (f != Face::INVALID) {
-                // damage 0 if != local_ply just to have particles
-                this->ply.scene.client.sound.play("impact.wav", vox2draw(hit) + .5f);
-                block_destroyed |= this->ply.scene.damage_point(hit.x, hit.y, hit.z, this->ply.local_player ? this->block_damage() : 0, f, !block_destroyed);
-            }
-
+        std::vector<world::RayHit> hits;
+        this->ply.scene.rays.trace(this->ply.e, dirs, &this->ply, hits);
 
-            for (auto &kv : this->ply.scene.players) {
-                if (!kv.second->alive || kv.second.get() == &this->ply) continue;
-
-                glm::vec3 h;
-                net::HIT type;
-
-                if (kv.second->mdl_head.sprhitscan(this->ply.e, dir, &h))
-                    type = net::HIT::HEAD;
-                else if (kv.second->mdl_torso.sprhitscan(this->ply.e, dir, &h))
-                    type = net::HIT::TORSO;
-                else if (kv.second->mdl_legl.sprhitscan(this->ply.e, dir, &h))
-                    type = net::HIT::LEGS;
-                else if (kv.second->mdl_legr.sprhitscan(this->ply.e, dir, &h))
-                    type = net::HIT::LEGS;
-                else
-                    continue;
-
-                // TODO: prevent being able to shoot through blocks
-
-                this->ply.scene.create_object<world::DebrisGroup>(h, glm::vec3{ 127, 0, 0 }, 0.25f, 4);
-                if (this->ply.local_player) {
-                    net::HitPacket hp;
-                    hp.pid = kv.second->pid;
-                    hp.value = type;
-                    this->ply.scene.client.net.send_packet(hp);
-                    break;
+        // stupid PYSPADES bans you if you spam BlockAction more than once per shot (shotgun creates problems)
+        bool block_destroyed = false;
+        for (const auto &hit : hits) {
+            // only players in front of the block count, and they stop the pellet before it gets to the block
+            if (hit.player == nullptr) {
+                if (hit.face != Face::INVALID) {
+                    // damage 0 if != local_ply just to have particles
+                    this->ply.scene.client.sound.play("impact.wav", vox2draw(hit.block) + .5f);
+                    block_destroyed |= this->ply.scene.damage_point(hit.block.x, hit.block.y, hit.block.z, this->ply.local_player ? this->block_damage() : 0, hit.face, !block_destroyed);
                 }
+                continue;
+            }
+
+            this->ply.scene.client.sound.play("impact.wav", vox2draw(hit.player_hit));
+            this->ply.scene.create_object<world::DebrisGroup>(hit.player_hit, glm::vec3{ 127, 0, 0 }, 0.25f, 4);
+            if (this->ply.local_player) {
+                net::HitPacket hp;
+                hp.pid = hit.player->pid;
+                hp.value = hit.type;
+                this->ply.scene.client.net.send_packet(hp);
             }
         }
 
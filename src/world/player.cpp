@@ -256,6 +256,12 @@ namespace ace { namespace world {
         mdl_legr(scene.models.get("playerleg.kv6")),
         mdl_legl(scene.models.get("playerleg.kv6")),
         mdl_dead(scene.models.get("playerdead.kv6")),
+        hitboxes{
+            { &mdl_head, net::HIT::HEAD, {}, {} },
+            { &mdl_torso, net::HIT::TORSO, {}, {} },
+            { &mdl_legl, net::HIT::LEGS, {}, {} },
+            { &mdl_legr, net::HIT::LEGS, {}, {} },
+        },
         local_player(local_player),
         blocks(*this), spade(*this), grenades(*this), switch_time(0.0) {
         this->set_weapon(net::WEAPON::SEMI);
@@ -533,6 +539,7 @@ namespace ace { namespace world {
                     mdl_legr.rotation.z = -rot2;
                 }
             }
+            this->update_hitboxes();
         } else {
             float bob = ((scene.ms_time & 511) - 255.f) * std::max(std::fabs(v.x), std::fabs(v.y)) / 1000.f;
             this->mdl_arms.position = { -0.01f, -0.45f + (v.z * 0.2f * airborne), 0.1f + (scene.ms_time & 1023) > 511 ? bob : -bob };
@@ -558,4 +565,37 @@ namespace ace { namespace world {
     void DrawPlayer::play_sound(const std::string &name, int volume) const {
         this->scene.client.sound.play(name, vox2draw(this->p), 100, this->local_player && !this->scene.thirdperson);
     }
+
+    void DrawPlayer::update_hitboxes() {
+        glm::vec3 corners[4 * 8], sum(0);
+        int n = 0;
+        for (auto &box : this->hitboxes) {
+            box.world = box.model->get_model();
+            box.inverse = glm::inverse(box.world);
+
+            // same box sprhitscan tests against
+            const KV6Mesh *mesh = box.model->mesh;
+            const glm::vec3 piv(mesh->xpiv, mesh->ypiv, mesh->zpiv), siz(mesh->xsiz, mesh->ysiz, mesh->zsiz);
+            const glm::vec3 min = vox2draw(-piv), max = vox2draw(siz - piv);
+            for (int i = 0; i < 8; i++) {
+                const glm::vec3 corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+                corners[n] = draw2vox(glm::vec3(box.world * glm::vec4(corner, 1.0f)));
+                sum += corners[n++];
+            }
+        }
+
+        this->hit_center = sum / float(n);
+        this->hit_radius = 0;
+        for (const auto &corner : corners) {
+            this->hit_radius = std::max(this->hit_radius, glm::length(corner - this->hit_center));
+        }
+    }
+
+    bool DrawPlayer::ray_near(const glm::vec3 &origin, const glm::vec3 &dir, float max_distance) const {
+        const glm::vec3 to_center = this->hit_center - origin;
+        const float along = glm::dot(to_center, glm::normalize(dir));
+        // sphere is behind the origin or starts past max_distance
+        if (along < -this->hit_radius || along - this->hit_radius > max_distance) return false;
+        return glm::dot(to_center, to_center) - along * along <= this->hit_radius * this->hit_radius;
+    }
 }}
\ No newline at end of file
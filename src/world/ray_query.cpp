@@ -0,0 +1,55 @@
+#include "world/ray_query.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "scene/game.h"
+
+namespace ace { namespace world {
+    namespace {
+        // distance from origin to where the ray goes into the block
+        float block_distance(const glm::vec3 &origin, const glm::vec3 &dir, const glm::ivec3 &block) {
+            float t = 0;
+            for (int i = 0; i < 3; i++) {
+                if (dir[i] == 0) continue;
+                const float t1 = (block[i] - origin[i]) / dir[i], t2 = (block[i] + 1 - origin[i]) / dir[i];
+                t = std::max(t, std::min(t1, t2));
+            }
+            return glm::length(dir * t);
+        }
+    }
+
+    void RayQuery::trace(const glm::vec3 &origin, const std::vector<glm::vec3> &dirs, const DrawPlayer *shooter, std::vector<RayHit> &hits) {
+        hits.assign(dirs.size(), RayHit());
+        for (size_t i = 0; i < dirs.size(); i++) {
+            const glm::vec3 &dir = dirs[i];
+            RayHit &hit = hits[i];
+
+            hit.face = this->scene.map.hitscan(origin, dir, &hit.block);
+            hit.block_distance = hit.face == Face::INVALID ? FLT_MAX : block_distance(origin, dir, hit.block);
+            hit.player_distance = FLT_MAX;
+
+            for (const auto &kv : this->scene.players) {
+                DrawPlayer *ply = kv.second.get();
+                if (ply == shooter || !ply->alive) continue;
+                // most players are nowhere near the ray, or behind something closer
+                if (!ply->ray_near(origin, dir, std::min(hit.player_distance, hit.block_distance))) continue;
+
+                for (const auto &box : ply->hitboxes) {
+                    glm::vec3 h;
+                    if (!box.model->sprhitscan(origin, dir, &h, box.world, box.inverse)) continue;
+
+                    // anything behind the block the ray stops at can't be shot
+                    const float distance = glm::length(h - origin);
+                    if (distance < hit.player_distance && distance < hit.block_distance) {
+                        hit.player = ply;
+                        hit.type = box.type;
+                        hit.player_hit = h;
+                        hit.player_distance = distance;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+}}